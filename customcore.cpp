@@ -45,6 +45,20 @@
 
 using namespace Inugami;
 
+namespace {
+
+ShaderProgram crazyProgram()
+{
+    ShaderProgram rval = ShaderProgram::fromName("shaders/crazy");
+
+    //Features are defined as macros in shader variants
+    rval.features = {"DISSOLVE"};
+
+    return rval;
+}
+
+} // namespace
+
 CustomCore::CustomCore(const RenderParams &params)
     : Core(params)
     , rotation(0.f)
@@ -57,14 +71,15 @@ CustomCore::CustomCore(const RenderParams &params)
     , noise    (64, 64)
     , noiseDir (64, 64, {1,1,1,1})
 
-    , shieldTex       (Image::fromPNG("data/shield.png"), true, false)
+    , shieldTex       (Image::fromFile("data/shield.png"), true, false)
     , noiseTex        ()
     , glassTex        (Image(32,32,{32,32,255,128}), false, false)
-    , fontRoll        (Spritesheet(Image::fromPNG("data/font.png"), 8, 8))
+    , fontRoll        (Spritesheet(Image::fromFile("data/font.png"), 8, 8))
     , shield          (Geometry::fromOBJ("data/shield.obj"))
     , shieldHD        (Geometry::fromOBJ("data/shieldHD.obj"))
     , defaultShader   (getShader())
-    , crazyShader     (ShaderProgram::fromName("shaders/crazy"))
+    , crazyShader     (crazyProgram(), true)
+    , dissolveShader  (crazyShader.variant(crazyShader.feature("DISSOLVE")))
 {
     ScopedProfile prof(profiler, "CustomCore: Constructor");
 
@@ -88,9 +103,12 @@ CustomCore::CustomCore(const RenderParams &params)
 
     setWindowTitle("Inugami Demo", true);
 
-    crazyShader.bind();
-    crazyShader.uniform("Tex0"    ).set(0);
-    crazyShader.uniform("noiseTex").set(1);
+    for (Shader* shader : {&crazyShader, &dissolveShader})
+    {
+        shader->bind();
+        shader->uniform("Tex0"    ).set(0);
+        shader->uniform("noiseTex").set(1);
+    }
 
     Image tmp = Image::fromNoise(64, 64);
     //tmp = blur(tmp);
@@ -113,7 +131,14 @@ CustomCore::CustomCore(const RenderParams &params)
 }
 
 CustomCore::~CustomCore()
-{}
+{
+    //Shaders count the uniform sets they skip because the value didn't change
+    for (Shader* shader : {&crazyShader, &dissolveShader})
+    {
+        auto stats = shader->getUniformStats();
+        logger->log("Uniform sets: ", stats.issued, " issued, ", stats.skipped, " skipped.");
+    }
+}
 
 void CustomCore::tick()
 {
@@ -190,22 +215,36 @@ void CustomCore::tick()
     //Shaders have easy access to uniforms
     if (shaderOn)
     {
-        crazyShader.bind();
-        crazyShader.uniform("dissolveMin").set( float(dissolveMin) );
-        crazyShader.uniform("dissolveMax").set( float(dissolveMax) );
-        crazyShader.uniform("hue").set( float(ticks/67.0) );
-
         Vec3 light(0.f,0.f,2.5f);
         light.x = mapRange(mousePos.x, 0,  getParams().width, -4.0, 4.0);
         light.y = mapRange(mousePos.y, getParams().height, 0, -3.0, 3.0);
-        crazyShader.uniform("lightPos").set( light );
 
-        for (int r=0; r<noise.height; ++r)
+        //OpenGL work is recorded, so it can be replayed on a render thread
+        float dMin = dissolveMin;
+        float dMax = dissolveMax;
+        float hue = ticks/67.0;
+        record([this, dMin, dMax, hue, light]
+        {
+            //Each variant is a separate program with its own uniforms
+            for (Shader* shader : {&crazyShader, &dissolveShader})
+            {
+                shader->bind();
+                shader->uniform("dissolveMin").set( dMin );
+                shader->uniform("dissolveMax").set( dMax );
+                shader->uniform("hue").set( hue );
+                shader->uniform("lightPos").set( light );
+            }
+        });
+
+        //Rows are independent, so they can be spread across the job system
+        auto pixels = noise   .view();
+        auto dirs   = noiseDir.view();
+        getJobs().parallelFor(0, noise.height, [&](int r)
         {
             for (int c=0; c<noise.width; ++c)
             {
-                auto&& pix = noise   .at(c, r);
-                auto&& dir = noiseDir.at(c, r);
+                auto&& pix = pixels[r][c];
+                auto&& dir = dirs  [r][c];
                 for (int i=0; i<4; ++i)
                 {
                     if (dir[i] == 1)
@@ -220,10 +259,15 @@ void CustomCore::tick()
                     }
                 }
             }
-        }
+        });
 
-        noiseTex = Texture(noise, true, false);
-        noiseTex.bind(1);
+        //Textures need the context too, so the upload is recorded with a copy
+        Image frame = noise;
+        record([this, frame]
+        {
+            noiseTex = Texture(frame, true, false);
+            noiseTex.bind(1);
+        });
     }
 }
 
@@ -237,7 +281,7 @@ void CustomCore::draw()
     {
         ScopedProfile prof(profiler, "3D");
 
-        setShader((shaderOn)? crazyShader : defaultShader);
+        setShader((shaderOn)? dissolveShader : defaultShader);
 
         //Cameras have view setters based on GLUT
         Camera cam;
@@ -256,18 +300,23 @@ void CustomCore::draw()
 
             modelMatrix(mat);
 
-            //Textures are set using bind()
-            shieldTex.bind(0);
-            noiseTex.bind(1);
-
-            if (shaderOn) crazyShader.uniform("useDissolve").set(1);
-
-            //Models use the currently bound texture
-            if (highDef) shieldHD.draw();
-            else         shield  .draw();
+            bool hd = highDef;
+            record([this, hd]
+            {
+                //Textures are set using bind()
+                shieldTex.bind(0);
+                noiseTex.bind(1);
+
+                //Models use the currently bound texture
+                if (hd) shieldHD.draw();
+                else    shield  .draw();
+            });
         }
 
         {
+            //Shader variants replace runtime branches on uniforms
+            if (shaderOn) setShader(crazyShader);
+
             cam.depthTest = true;
             cam.cullFaces = true;
             applyCam(cam);
@@ -278,15 +327,17 @@ void CustomCore::draw()
             modelMatrix(mat);
             mat.pop();
 
-            //Textures are set using bind()
-            glassTex.bind(0);
-            noiseTex.bind(1);
-
-            if (shaderOn) crazyShader.uniform("useDissolve").set(0);
-
-            //Models use the currently bound texture
-            if (highDef) shieldHD.draw();
-            else         shield  .draw();
+            bool hd = highDef;
+            record([this, hd]
+            {
+                //Textures are set using bind()
+                glassTex.bind(0);
+                noiseTex.bind(1);
+
+                //Models use the currently bound texture
+                if (hd) shieldHD.draw();
+                else    shield  .draw();
+            });
         }
     }
 
@@ -63,6 +63,7 @@ private:
     Inugami::Mesh           shieldHD;
     Inugami::Shader         defaultShader;
     Inugami::Shader         crazyShader;
+    Inugami::Shader         dissolveShader;
 };
 
 #endif // CUSTOMCORE_H
@@ -94,7 +94,11 @@ void AnimatedSprite::draw(Core& core, Transform in) const
     in.scale(Vec3{((flipX)?-1.f:1.f)*scale, ((flipY)?-1.f:1.f)*scale, 1.f});
     in.rotate(rot, Vec3{0.f, 0.f, 1.f});
     core.modelMatrix(in);
-    sheet.draw(sprite.first, sprite.second);
+
+    const Spritesheet* target = &sheet;
+    int r = sprite.first;
+    int c = sprite.second;
+    core.record([target, r, c]{ target->draw(r, c); });
 }
 
 void AnimatedSprite::tick()
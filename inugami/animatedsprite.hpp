@@ -130,6 +130,9 @@ public:
      *  Draws the current frame using the given @ref Transform.
      *
      *  @note The core's model matrix will be set.
+     *  @note The draw is recorded with Core::record(). With a render thread,
+     *  the sprite must stay alive, and keep its @ref Spritesheet, until the
+     *  frame has been replayed.
      *
      *  @param core The @ref Core to use for drawing.
      *  @param in The @ref Transform to use as the origin.
@@ -33,9 +33,12 @@
 #include "loaders.hpp"
 #include "shaderprogram.hpp"
 
+#include <algorithm>
+#include <exception>
 #include <iomanip>
 #include <ostream>
 #include <sstream>
+#include <thread>
 
 namespace Inugami {
 
@@ -69,13 +72,16 @@ Core::RenderParams::RenderParams()
     , fullscreen(false)
     , vsync(true)
     , fsaaSamples(0)
+    , shaderCache()
+    , renderThread(false)
 {}
 
 Core::Core(const RenderParams &params)
     : running(false)
     , iface(nullptr)
 
-    , callbacks()
+    , scheduler()
+    , jobs(std::max(std::thread::hardware_concurrency(), 1u)-1)
 
     , frameStartTime(0.f)
     , frameRateStack(10, 0.0)
@@ -90,6 +96,19 @@ Core::Core(const RenderParams &params)
     , viewProjection(1.f)
 
     , shader()
+    , renderShader()
+    , uniforms()
+    , frameBuffer(0)
+
+    , recording()
+    , submitted()
+    , renderer()
+    , renderMutex()
+    , renderWake()
+    , renderIdle()
+    , renderBusy(false)
+    , renderStopping(false)
+    , renderError()
 {
     if (numCores == 0) glfwInit();
 
@@ -156,7 +175,18 @@ Core::Core(const RenderParams &params)
     glEnableClientState(GL_NORMAL_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 
+#ifndef INU_NO_SHADERS
+    glGenBuffers(1, &frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Shader::FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FRAME_BINDING, frameBuffer);
+#endif // INU_NO_SHADERS
+
+    Shader::setBinaryCache(rparams.shaderCache);
+    Shader::setParallelCompile(0xFFFFFFFF);
     shader = Shader(ShaderProgram::fromDefault());
+    resolveUniforms(shader);
 
     iface = std::unique_ptr<Interface>(new Interface(window)); //! @todo make_unique
 
@@ -167,6 +197,10 @@ Core::~Core()
 {
     activate();
 
+#ifndef INU_NO_SHADERS
+    glDeleteBuffers(1, &frameBuffer);
+#endif // INU_NO_SHADERS
+
     glfwDestroyWindow(window);
 
     if (--numCores == 0)
@@ -187,8 +221,6 @@ void Core::deactivate() const
 
 void Core::beginFrame()
 {
-    activate();
-
     *frStackIterator = getInstantFrameRate();
     ++frStackIterator;
 
@@ -199,9 +231,12 @@ void Core::beginFrame()
 
     frameStartTime = glfwGetTime();
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    getShader().bind();
+    record([this]
+    {
+        activate();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderShader.bind();
+    });
 
     //Title
     if (windowTitleShowFPS)
@@ -214,7 +249,32 @@ void Core::beginFrame()
 
 void Core::endFrame()
 {
-    glfwSwapBuffers(window);
+    record([this]
+    {
+        glfwSwapBuffers(window);
+    });
+
+    if (renderer.joinable()) submit(recording);
+}
+
+void Core::invoke(std::function<void()> func)
+{
+    if (!renderer.joinable())
+    {
+        func();
+        return;
+    }
+
+    std::vector<Command> list;
+    list.push_back(std::move(func));
+    submit(list);
+
+    std::unique_lock<std::mutex> lock(renderMutex);
+    renderIdle.wait(lock, [&]{ return !renderBusy; });
+
+    auto error = std::move(renderError);
+    renderError = nullptr;
+    if (error) std::rethrow_exception(error);
 }
 
 double Core::getInstantFrameRate() const
@@ -231,37 +291,66 @@ double Core::getAverageFrameRate() const
 
 void Core::applyCam(const Camera& in)
 {
-    activate();
+    viewProjection = in.getProjection()*in.getView();
+
+    bool cullFaces = in.cullFaces;
+    bool depthTest = in.depthTest;
+#ifndef INU_NO_SHADERS
+    Mat4 view = in.getView();
+    Mat4 projection = in.getProjection();
+    Mat4 viewProj = viewProjection;
+    float time = frameStartTime;
+#endif // INU_NO_SHADERS
+
+    record([=]
+    {
+        activate();
 
-    //Cull faces
-    if (in.cullFaces) glEnable (GL_CULL_FACE);
-    else              glDisable(GL_CULL_FACE);
+        //Cull faces
+        if (cullFaces) glEnable (GL_CULL_FACE);
+        else           glDisable(GL_CULL_FACE);
 
-    if (in.depthTest) glEnable (GL_DEPTH_TEST);
-    else              glDisable(GL_DEPTH_TEST);
+        if (depthTest) glEnable (GL_DEPTH_TEST);
+        else           glDisable(GL_DEPTH_TEST);
 
 #ifndef INU_NO_SHADERS
-    getShader().uniform("projectionMatrix").set(in.getProjection());
-    getShader().uniform("viewMatrix"      ).set(in.getView()      );
-    getShader().uniform("modelMatrix"     ).set(glm::mat4(1.f)    );
+        Shader::FrameBlock frame;
+        frame.viewMatrix       = view;
+        frame.projectionMatrix = projection;
+        frame.viewProjection   = viewProj;
+        frame.screenSize       = Vec2(rparams.width, rparams.height);
+        frame.time             = time;
+        frame.padding          = 0.f;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        uniforms.projection.set(projection);
+        uniforms.view      .set(view      );
+        uniforms.model     .set(Mat4(1.f) );
 #endif // INU_NO_SHADERS
 
-    viewProjection = in.getProjection()*in.getView();
-
-    glClear(GL_DEPTH_BUFFER_BIT);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    });
 }
 
 void Core::modelMatrix(const Mat4& in)
 {
-    activate();
+    Mat4 viewProj = viewProjection;
+
+    record([=]
+    {
+        activate();
 
 #ifndef INU_NO_SHADERS
-    getShader().uniform("modelMatrix").set(in               );
-    getShader().uniform("MVP"        ).set(viewProjection*in);
+        uniforms.model.set(in);
+        if (uniforms.mvp.isActive()) uniforms.mvp.set(viewProj*in);
 #else
-    auto modelmat = viewProjection * in;
-    glLoadMatrixf(&modelmat[0][0]);
+        auto modelmat = viewProj * in;
+        glLoadMatrixf(&modelmat[0][0]);
 #endif // INU_NO_SHADERS
+    });
 }
 
 void Core::setWindowTitle(const char* text, bool showFPS)
@@ -276,45 +365,68 @@ const Core::RenderParams& Core::getParams() const
     return rparams;
 }
 
-void Core::addCallback(std::function<void()> func, double freq)
+Scheduler::Timer Core::addCallback(std::function<void()> func, double freq)
+{
+    return scheduler.addRepeating(std::move(func), freq);
+}
+
+Scheduler::Timer Core::addTimer(std::function<void()> func, double delay)
 {
-    callbacks.push_back({func, freq, glfwGetTime()});
+    return scheduler.addOneShot(std::move(func), delay);
 }
 
 void Core::clearCallbacks()
 {
-    callbacks.clear();
+    scheduler.clear();
 }
 
 void Core::go()
 {
+    //Time left before a deadline at which to stop sleeping and start spinning
+    static constexpr auto spinTime = std::chrono::milliseconds(2);
+
     running = true;
 
-    double currentTime = 0.0;
-    double deltaTime = 0.0;
+    //Started here rather than in the constructor, so a derived core builds
+    //and destroys its members with the context current
+    if (rparams.renderThread) startRenderThread();
 
-    while (running)
+    try
     {
-        for (auto& cb : callbacks)
+        while (running)
         {
-            if (cb.freq < 0.0)
+            auto wake = scheduler.dispatch(running);
+
+            if (!running || wake == Clock::time_point::min()) continue;
+
+            //Nothing is scheduled, but a callback may still be added from outside
+            if (wake == Clock::time_point::max())
             {
-                cb.func();
+                std::this_thread::sleep_for(spinTime);
                 continue;
             }
 
-            currentTime = glfwGetTime();
-            deltaTime = (currentTime - cb.last)*cb.freq;
-
-            if (deltaTime >= 1.0)
+            if (wake - Clock::now() > spinTime)
             {
-                cb.last = currentTime;
-                cb.func();
+                std::this_thread::sleep_until(wake - spinTime);
             }
 
-            if (!running) break;
+            while (Clock::now() < wake) std::this_thread::yield();
         }
     }
+    catch (...)
+    {
+        stopRenderThread();
+        throw;
+    }
+
+    auto error = stopRenderThread();
+    if (error) std::rethrow_exception(error);
+}
+
+JobSystem& Core::getJobs()
+{
+    return jobs;
 }
 
 const Shader& Core::getShader() const
@@ -325,7 +437,108 @@ const Shader& Core::getShader() const
 void Core::setShader(const Shader& in)
 {
     shader = in;
-    shader.bind();
+
+    record([this, in]
+    {
+        in.bind();
+        resolveUniforms(in);
+    });
+}
+
+void Core::resolveUniforms(const Shader& in)
+{
+    renderShader = in;
+
+#ifndef INU_NO_SHADERS
+    uniforms.projection = in.uniformHandle<Mat4>("projectionMatrix");
+    uniforms.view       = in.uniformHandle<Mat4>("viewMatrix"      );
+    uniforms.model      = in.uniformHandle<Mat4>("modelMatrix"     );
+    uniforms.mvp        = in.uniformHandle<Mat4>("MVP"             );
+#endif // INU_NO_SHADERS
+}
+
+void Core::submit(std::vector<Command>& list)
+{
+    std::unique_lock<std::mutex> lock(renderMutex);
+    renderIdle.wait(lock, [&]{ return !renderBusy; });
+
+    auto error = std::move(renderError);
+    renderError = nullptr;
+
+    //The render thread leaves the previous list empty
+    submitted.swap(list);
+    renderBusy = true;
+
+    lock.unlock();
+    renderWake.notify_one();
+
+    if (error) std::rethrow_exception(error);
+}
+
+void Core::startRenderThread()
+{
+    deactivate();
+    renderStopping = false;
+    renderer = std::thread([this]{ renderLoop(); });
+}
+
+std::exception_ptr Core::stopRenderThread()
+{
+    if (!renderer.joinable()) return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        renderStopping = true;
+    }
+    renderWake.notify_one();
+    renderer.join();
+
+    activate();
+
+    //Commands that were never submitted may hold the last handles to GL
+    //resources
+    recording.clear();
+
+    auto error = std::move(renderError);
+    renderError = nullptr;
+    return error;
+}
+
+void Core::renderLoop()
+{
+    activate();
+
+    std::unique_lock<std::mutex> lock(renderMutex);
+
+    for (;;)
+    {
+        renderWake.wait(lock, [&]{ return renderStopping || renderBusy; });
+        if (!renderBusy) break;
+
+        lock.unlock();
+
+        std::exception_ptr error;
+
+        try
+        {
+            for (auto&& cmd : submitted) cmd();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        //Resources held by the commands must be released with the context
+        submitted.clear();
+
+        lock.lock();
+        if (error && !renderError) renderError = error;
+        renderBusy = false;
+        renderIdle.notify_all();
+    }
+
+    lock.unlock();
+    deactivate();
 }
 
 int Core::getWindowAttrib(int param) const
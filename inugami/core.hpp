@@ -30,13 +30,19 @@
 
 #include "inugami.hpp"
 
+#include "jobsystem.hpp"
+#include "scheduler.hpp"
 #include "shader.hpp"
 #include "transform.hpp"
 #include "utility.hpp"
 
+#include <condition_variable>
+#include <exception>
 #include <functional>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Inugami {
@@ -62,6 +68,8 @@ public:
         bool fullscreen;    //!< Fullscreen mode.
         bool vsync;         //!< Waits for vertical sync.
         int fsaaSamples;    //!< Number of samples to use for FSAA.
+        std::string shaderCache; //!< Shader binary cache directory, or empty.
+        bool renderThread;  //!< Replays rendering on a dedicated thread during go().
     };
 
     Core() = delete;
@@ -85,6 +93,9 @@ public:
     Core& operator=(Core&&) = delete;
 
     /*! @brief Activates the core's context.
+     *
+     *  @note With RenderParams::renderThread, the context belongs to the
+     *  render thread while go() runs. Use record() or invoke() instead.
      */
     void activate() const;
 
@@ -106,9 +117,52 @@ public:
      *
      *  Typically called at the end of a global drawing routine. This will
      *  flush all drawing to the screen.
+     *
+     *  While the render thread runs, the commands recorded since the last
+     *  frame are handed to it. This waits for the render
+     *  thread to finish replaying the previous frame, so recording a frame
+     *  overlaps the submission of the one before it. Exceptions thrown while
+     *  replaying are rethrown here, one frame late.
      */
     void endFrame();
 
+    /*! @brief Records a render command.
+     *
+     *  While the render thread runs, @a func is called on it, when the
+     *  current frame is replayed. Otherwise, @a func is called immediately.
+     *
+     *  Core's own rendering functions record themselves, as does
+     *  AnimatedSprite::draw(). Other OpenGL work, such as Mesh::draw(),
+     *  Texture::bind() and setting uniforms, must be recorded by the caller.
+     *
+     *  Values that may change before the frame is replayed should be
+     *  captured by copy. Resource handles such as Mesh, Texture and Shader
+     *  can be captured by value, so they stay alive until the command has
+     *  run.
+     *
+     *  @param func Command to record.
+     */
+    template <typename F>
+    void record(F&& func)
+    {
+        if (renderer.joinable()) recording.emplace_back(std::forward<F>(func));
+        else func();
+    }
+
+    /*! @brief Runs a function with the OpenGL context.
+     *
+     *  While the render thread runs, @a func is run on it between frames,
+     *  and this waits for it to finish. Otherwise, @a func is called
+     *  immediately.
+     *
+     *  Resources need the context when they are created and destroyed. While
+     *  the render thread runs, do both in a recorded command or here, for
+     *  example by assigning a new Texture to a member inside @a func.
+     *
+     *  @param func Function to run.
+     */
+    void invoke(std::function<void()> func);
+
     /*! @brief Returns the current graphical framerate.
      */
     double getInstantFrameRate() const;
@@ -119,7 +173,10 @@ public:
 
     /*! @brief Applies a camera to the scene.
      *
-     *  The given camera's matrices are uploaded to the gpu.
+     *  The given camera's matrices are uploaded to the gpu. They are written
+     *  to the frame uniform block (see Shader::FRAME_BLOCK), which is shared
+     *  by every shader, and to the current shader's @a projectionMatrix and
+     *  @a viewMatrix uniforms if it declares them.
      *
      *  @param in The camera to apply.
      */
@@ -154,12 +211,27 @@ public:
     /*! @brief Adds a callback.
      *
      *  Sets the given function to be called during the @ref go() cycle at the
-     *  given frequency.
+     *  given frequency. A negative frequency calls the function on every
+     *  cycle.
      *
      *  @param func Function to add.
      *  @param freq Call frequency, in Hertz.
+     *
+     *  @return Handle to cancel or reschedule the callback.
      */
-    void addCallback(std::function<void()> func, double freq);
+    Scheduler::Timer addCallback(std::function<void()> func, double freq);
+
+    /*! @brief Adds a one-shot callback.
+     *
+     *  Sets the given function to be called once during the @ref go() cycle,
+     *  after the given delay.
+     *
+     *  @param func Function to add.
+     *  @param delay Delay, in seconds.
+     *
+     *  @return Handle to cancel or reschedule the callback.
+     */
+    Scheduler::Timer addTimer(std::function<void()> func, double delay);
 
     /*! @brief Removes all callbacks.
      */
@@ -169,9 +241,28 @@ public:
      *
      *  This functions runs a loop that calls registered functions at the
      *  specified frequencies. The loop continues while Core::running is true.
+     *
+     *  Between calls, the thread sleeps until shortly before the earliest
+     *  deadline, then spins for the remainder. No sleeping is done while a
+     *  callback with a negative frequency is registered.
+     *
+     *  With RenderParams::renderThread, the render thread is started here
+     *  and takes over the context. It is stopped before this returns, and
+     *  the context is made current on the calling thread again. Resources
+     *  that are built and destroyed outside of go(), such as members of a
+     *  derived core, therefore need no special care.
      */
     void go();
 
+    /*! @brief Gets the job system.
+     *
+     *  The job system has one worker less than the number of hardware
+     *  threads, and the thread that constructed the core takes part in it.
+     *
+     *  @return The core's job system.
+     */
+    JobSystem& getJobs();
+
     /*! @brief Gets the current shader.
      *
      *  @return The current shader.
@@ -220,11 +311,14 @@ public:
 
 private:
     using Window = GLFWwindow*;
+    using Clock = Scheduler::Clock;
 
-    struct Callback
+    struct ShaderUniforms
     {
-        std::function<void()> func;
-        double freq, last;
+        Shader::TypedUniform<Mat4> projection;
+        Shader::TypedUniform<Mat4> view;
+        Shader::TypedUniform<Mat4> model;
+        Shader::TypedUniform<Mat4> mvp;
     };
 
     static void init();
@@ -232,7 +326,16 @@ private:
 
     static int numCores;
 
-    std::vector<Callback> callbacks;
+    using Command = std::function<void()>;
+
+    void resolveUniforms(const Shader& in);
+    void submit(std::vector<Command>& list);
+    void renderLoop();
+    void startRenderThread();
+    std::exception_ptr stopRenderThread();
+
+    Scheduler scheduler;
+    JobSystem jobs;
 
     double frameStartTime;
     std::list<double> frameRateStack;
@@ -248,6 +351,20 @@ private:
     Mat4 viewProjection;
 
     Shader shader;
+    Shader renderShader;
+    ShaderUniforms uniforms;
+
+    GLuint frameBuffer;
+
+    std::vector<Command> recording;
+    std::vector<Command> submitted;
+    std::thread renderer;
+    std::mutex renderMutex;
+    std::condition_variable renderWake;
+    std::condition_variable renderIdle;
+    bool renderBusy;
+    bool renderStopping;
+    std::exception_ptr renderError;
 };
 
 } // namespace Inugami
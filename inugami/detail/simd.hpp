@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_DETAIL_SIMD_HPP
+#define INUGAMI_DETAIL_SIMD_HPP
+
+/*  Instruction set selection for the vectorized image kernels.
+ *
+ *  The widest instruction set enabled by the compiler flags is used. Define
+ *  INU_NO_SIMD to force the scalar fallbacks.
+ */
+
+#ifndef INU_NO_SIMD
+#   if defined(__AVX2__)
+#       define INU_SIMD_AVX2
+#   endif
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define INU_SIMD_SSE2
+#   endif
+#endif // INU_NO_SIMD
+
+#if defined(INU_SIMD_AVX2)
+#   include <immintrin.h>
+#elif defined(INU_SIMD_SSE2)
+#   include <emmintrin.h>
+#endif
+
+/*  Width-generic intrinsics.
+ *
+ *  INU_MM(op) names the widest enabled form of an intrinsic, and INU_SI(op)
+ *  the widest form of an integer load, store, or bitwise intrinsic. SIMD::Vec
+ *  and SIMD::VecF are the matching integer and float vector types. None of
+ *  these are defined when only the scalar fallbacks are enabled.
+ */
+
+#if defined(INU_SIMD_AVX2)
+#   define INU_MM(op) _mm256_##op
+#   define INU_SI(op) _mm256_##op##_si256
+#elif defined(INU_SIMD_SSE2)
+#   define INU_MM(op) _mm_##op
+#   define INU_SI(op) _mm_##op##_si128
+#endif
+
+#ifdef INU_MM
+namespace Inugami {
+namespace SIMD {
+
+#if defined(INU_SIMD_AVX2)
+using Vec = __m256i;
+using VecF = __m256;
+#else
+using Vec = __m128i;
+using VecF = __m128;
+#endif
+
+} // namespace SIMD
+} // namespace Inugami
+#endif // INU_MM
+
+#endif // INUGAMI_DETAIL_SIMD_HPP
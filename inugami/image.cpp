@@ -28,12 +28,23 @@
 #include "image.hpp"
 
 #include "exception.hpp"
+#include "imagetransform.hpp"
+#include "mappedimage.hpp"
 #include "math.hpp"
+#include "noise.hpp"
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
 
-#include <png++/png.hpp>
+#include <png.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <cmath>
-#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -62,60 +73,682 @@ public:
     }
 };
 
+class ImageE_PNG
+    : public Exception
+{
+    std::string err;
+public:
+    ImageE_PNG(const std::string& filename, const std::string& msg)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::Image Exception: PNG file \"" << filename
+           << "\": " << msg
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+class ImageE_QOI
+    : public Exception
+{
+    std::string err;
+public:
+    ImageE_QOI(const std::string& filename, const std::string& msg)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::Image Exception: QOI file \"" << filename
+           << "\": " << msg
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+class ImageE_Format
+    : public Exception
+{
+    std::string err;
+public:
+    ImageE_Format(const std::string& filename)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::Image Exception: Unknown format of \"" << filename
+           << "\"."
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+namespace {
+
+std::uint32_t readBE(const unsigned char* p)
+{
+    return std::uint32_t(p[0])<<24 | std::uint32_t(p[1])<<16 | std::uint32_t(p[2])<<8 | p[3];
+}
+
+void writeBE(unsigned char* p, std::uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+struct PNGError
+{
+    char msg[256];
+};
+
+void pngError(png_structp png, png_const_charp msg)
+{
+    auto e = static_cast<PNGError*>(png_get_error_ptr(png));
+    std::strncpy(e->msg, msg, sizeof(e->msg)-1);
+    png_longjmp(png, 1);
+}
+
+void pngWarning(png_structp, png_const_charp)
+{}
+
+// libpng reports errors with longjmp, so everything with a destructor must
+// live in the caller's frame.
+bool decodePNG(png_structp png, png_infop info, std::FILE* file, Image& img, std::vector<png_bytep>& rows)
+{
+    if (setjmp(png_jmpbuf(png))) return false;
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+
+    int w = png_get_image_width(png, info);
+    int h = png_get_image_height(png, info);
+    int depth = png_get_bit_depth(png, info);
+    int type = png_get_color_type(png, info);
+    bool trns = png_get_valid(png, info, PNG_INFO_tRNS);
+
+    if (type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+    if (type == PNG_COLOR_TYPE_GRAY && depth < 8) png_set_expand_gray_1_2_4_to_8(png);
+    if (trns) png_set_tRNS_to_alpha(png);
+
+#ifdef PNG_READ_SCALE_16_TO_8_SUPPORTED
+    if (depth == 16) png_set_scale_16(png);
+#else
+    if (depth == 16) png_set_strip_16(png);
+#endif
+
+    if (!(type & PNG_COLOR_MASK_COLOR)) png_set_gray_to_rgb(png);
+    if (!(type & PNG_COLOR_MASK_ALPHA) && !trns) png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    if (png_get_rowbytes(png, info) != w*sizeof(Pixel)) png_error(png, "Unsupported format.");
+
+    img.resize(w, h);
+
+    // Images are stored bottom-up, so libpng is handed the rows in reverse.
+    rows.resize(h);
+    for (int r=0; r<h; ++r) rows[r] = &img[h-r-1][0][0];
+
+    png_read_image(png, &rows[0]);
+    png_read_end(png, nullptr);
+
+    return true;
+}
+
+/*  PNG encoding.
+ *
+ *  Rows are filtered and compressed in bands on the thread pool. Each band
+ *  is compressed as raw deflate data that ends on a byte boundary, so the
+ *  bands can be joined into one zlib stream. Bands are primed with the end
+ *  of the previous band, so little compression is lost by splitting them.
+ */
+
+const unsigned char PNG_SIGNATURE[8] = {137,'P','N','G',13,10,26,10};
+const std::size_t PNG_WINDOW = 32768;
+
+// None, Sub, Up, Average, and Paeth, in the order of their type bytes.
+const int PNG_FILTERS = 5;
+
+int paeth(int a, int b, int c)
+{
+    const int pa = std::abs(b-c);
+    const int pb = std::abs(a-c);
+    const int pc = std::abs(a+b-2*c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Filtered bytes are scored by their sum as signed values, the usual
+// heuristic for choosing a filter.
+int cost(SubPixel v)
+{
+    return std::min<int>(v, 256-v);
+}
+
+// Applies every filter to one byte, adding the results to the scores.
+void filterByte(int x, int a, int b, int c, SubPixel* const out[PNG_FILTERS], int i, std::uint64_t* score)
+{
+    const SubPixel f[PNG_FILTERS] = {
+          SubPixel(x)
+        , SubPixel(x-a)
+        , SubPixel(x-b)
+        , SubPixel(x-((a+b)>>1))
+        , SubPixel(x-paeth(a, b, c))
+    };
+
+    for (int k=0; k<PNG_FILTERS; ++k)
+    {
+        out[k][i] = f[k];
+        score[k] += cost(f[k]);
+    }
+}
+
+#ifdef INU_MM
+
+using SIMD::Vec;
+
+Vec loadRow(const SubPixel* p)
+{
+    return INU_SI(loadu)(reinterpret_cast<const Vec*>(p));
+}
+
+Vec abs16(Vec v)
+{
+    return INU_MM(max_epi16)(v, INU_MM(sub_epi16)(INU_SI(setzero)(), v));
+}
+
+// Picks a where m is set, and b elsewhere.
+Vec select(Vec m, Vec a, Vec b)
+{
+    return INU_SI(or)(INU_SI(and)(m, a), INU_SI(andnot)(m, b));
+}
+
+Vec paeth16(Vec a, Vec b, Vec c)
+{
+    const Vec bc = INU_MM(sub_epi16)(b, c);
+    const Vec ac = INU_MM(sub_epi16)(a, c);
+    const Vec pa = abs16(bc);
+    const Vec pb = abs16(ac);
+    const Vec pc = abs16(INU_MM(add_epi16)(bc, ac));
+    const Vec useA = INU_SI(andnot)(INU_SI(or)(INU_MM(cmpgt_epi16)(pa, pb), INU_MM(cmpgt_epi16)(pa, pc)), INU_MM(set1_epi16)(-1));
+    const Vec useB = INU_SI(andnot)(INU_MM(cmpgt_epi16)(pb, pc), INU_MM(set1_epi16)(-1));
+    return select(useA, a, select(useB, b, c));
+}
+
+Vec paeth8(Vec a, Vec b, Vec c)
+{
+    const Vec z = INU_SI(setzero)();
+    const Vec lo = paeth16(INU_MM(unpacklo_epi8)(a, z), INU_MM(unpacklo_epi8)(b, z), INU_MM(unpacklo_epi8)(c, z));
+    const Vec hi = paeth16(INU_MM(unpackhi_epi8)(a, z), INU_MM(unpackhi_epi8)(b, z), INU_MM(unpackhi_epi8)(c, z));
+    return INU_MM(packus_epi16)(lo, hi);
+}
+
+// Sums the scores of a vector of filtered bytes, in 64-bit lanes.
+Vec score8(Vec v)
+{
+    const Vec z = INU_SI(setzero)();
+    return INU_MM(sad_epu8)(INU_MM(min_epu8)(v, INU_MM(sub_epi8)(z, v)), z);
+}
+
+#endif // INU_MM
+
+// Filters a row of n bytes with the filter that scores lowest, writing the
+// filter type and the filtered bytes to out. Each filter is first written
+// to its own scratch row.
+void filterRow(const SubPixel* cur, const SubPixel* prev, int n, std::vector<SubPixel>& scratch, SubPixel* out)
+{
+    SubPixel* rows[PNG_FILTERS];
+    for (int k=0; k<PNG_FILTERS; ++k) rows[k] = &scratch[k*n];
+
+    std::uint64_t score[PNG_FILTERS] = {};
+
+    int i = 0;
+    for (; i<std::min(n, 4); ++i) filterByte(cur[i], 0, prev[i], 0, rows, i, score);
+
+#ifdef INU_MM
+    Vec sums[PNG_FILTERS];
+    for (auto& s : sums) s = INU_SI(setzero)();
+
+    for (; i+int(sizeof(Vec))<=n; i+=sizeof(Vec))
+    {
+        const Vec x = loadRow(cur+i);
+        const Vec a = loadRow(cur+i-4);
+        const Vec b = loadRow(prev+i);
+        const Vec c = loadRow(prev+i-4);
+
+        const Vec avg = INU_MM(sub_epi8)(INU_MM(avg_epu8)(a, b), INU_SI(and)(INU_SI(xor)(a, b), INU_MM(set1_epi8)(1)));
+
+        const Vec f[PNG_FILTERS] = {
+              x
+            , INU_MM(sub_epi8)(x, a)
+            , INU_MM(sub_epi8)(x, b)
+            , INU_MM(sub_epi8)(x, avg)
+            , INU_MM(sub_epi8)(x, paeth8(a, b, c))
+        };
+
+        for (int k=0; k<PNG_FILTERS; ++k)
+        {
+            INU_SI(storeu)(reinterpret_cast<Vec*>(rows[k]+i), f[k]);
+            sums[k] = INU_MM(add_epi64)(sums[k], score8(f[k]));
+        }
+    }
+
+    for (int k=0; k<PNG_FILTERS; ++k)
+    {
+        std::uint64_t lanes[sizeof(Vec)/8];
+        INU_SI(storeu)(reinterpret_cast<Vec*>(lanes), sums[k]);
+        for (auto l : lanes) score[k] += l;
+    }
+#endif
+
+    for (; i<n; ++i) filterByte(cur[i], cur[i-4], prev[i], prev[i-4], rows, i, score);
+
+    const int best = std::min_element(score, score+PNG_FILTERS)-score;
+
+    out[0] = best;
+    std::copy(rows[best], rows[best]+n, out+1);
+}
+
+void writeChunk(std::ofstream& out, const char* type, const unsigned char* data, std::size_t size)
+{
+    unsigned char head[8];
+    writeBE(head, size);
+    std::memcpy(head+4, type, 4);
+
+    uLong crc = crc32(0, head+4, 4);
+    if (size > 0) crc = crc32(crc, data, size);
+
+    unsigned char tail[4];
+    writeBE(tail, crc);
+
+    out.write(reinterpret_cast<const char*>(head), 8);
+    out.write(reinterpret_cast<const char*>(data), size);
+    out.write(reinterpret_cast<const char*>(tail), 4);
+}
+
+// Compresses a band as raw deflate data. All bands but the last end with a
+// sync flush, which pads them to a byte boundary.
+bool deflateBand(const std::vector<SubPixel>& in, const std::vector<SubPixel>* prior, int level, bool last, std::vector<unsigned char>& out)
+{
+    z_stream s = {};
+    if (deflateInit2(&s, level, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK) return false;
+
+    if (prior)
+    {
+        const std::size_t dict = std::min(prior->size(), PNG_WINDOW);
+        deflateSetDictionary(&s, prior->data()+prior->size()-dict, dict);
+    }
+
+    out.resize(deflateBound(&s, in.size())+16);
+
+    s.next_in = const_cast<Bytef*>(in.data());
+    s.avail_in = in.size();
+
+    int status;
+    do
+    {
+        if (s.total_out == out.size()) out.resize(out.size()*2);
+        s.next_out = out.data()+s.total_out;
+        s.avail_out = out.size()-s.total_out;
+        status = deflate(&s, last? Z_FINISH : Z_SYNC_FLUSH);
+    }
+    while (status == Z_OK && (last || s.avail_out == 0));
+
+    out.resize(s.total_out);
+    deflateEnd(&s);
+
+    return (status == (last? Z_STREAM_END : Z_OK));
+}
+
+} // namespace
+
 Image Image::fromPNG(const std::string& filename) //static
 {
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(filename.c_str(), "rb"), &std::fclose);
+    if (!file) throw ImageE_PNG(filename, "Could not open file.");
+
+    png_byte sig[8];
+    if (std::fread(sig, 1, 8, file.get()) != 8 || png_sig_cmp(sig, 0, 8) != 0)
+    {
+        throw ImageE_PNG(filename, "Not a PNG file.");
+    }
+
+    PNGError error = {"Out of memory."};
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &error, &pngError, &pngWarning);
+    png_infop info = (png)? png_create_info_struct(png) : nullptr;
+
     Image rval;
+    std::vector<png_bytep> rows;
+
+    bool ok = false;
+    if (info)
+    {
+        png_set_sig_bytes(png, 8);
+        ok = decodePNG(png, info, file.get(), rval, rows);
+    }
+
+    png_destroy_read_struct(&png, &info, nullptr);
+
+    if (!ok) throw ImageE_PNG(filename, error.msg);
+
+    return rval;
+}
+
+namespace {
+
+/*  QOI, the "Quite OK Image" format.
+ *
+ *  Pixels are coded in order from the top row down as runs of the previous
+ *  pixel, references into a 64-entry hash table of recent pixels, small
+ *  differences from the previous pixel, or literals.
+ */
+
+const unsigned char QOI_MAGIC[4] = {'q','o','i','f'};
+const unsigned char QOI_END[8] = {0,0,0,0,0,0,0,1};
+const std::size_t QOI_HEADER = 14;
+const std::size_t QOI_PIXELS_MAX = 400000000;
+
+enum : unsigned char
+{
+      QOI_OP_INDEX = 0x00
+    , QOI_OP_DIFF  = 0x40
+    , QOI_OP_LUMA  = 0x80
+    , QOI_OP_RUN   = 0xc0
+    , QOI_OP_RGB   = 0xfe
+    , QOI_OP_RGBA  = 0xff
+    , QOI_MASK     = 0xc0
+};
+
+int qoiHash(const SubPixel* p)
+{
+    return (p[0]*3 + p[1]*5 + p[2]*7 + p[3]*11) & 63;
+}
+
+std::vector<unsigned char> readFile(const std::string& filename)
+{
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in) throw ImageE_QOI(filename, "Could not open file.");
+
+    std::vector<unsigned char> rval;
+    in.seekg(0, std::ios::end);
+    rval.resize(std::size_t(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char*>(rval.data()), rval.size());
+
+    return rval;
+}
 
-    png::image<png::rgba_pixel> image(filename);
+Image decodeQOI(const std::string& filename, const std::vector<unsigned char>& data)
+{
+    if (data.size() < QOI_HEADER+sizeof(QOI_END) || std::memcmp(data.data(), QOI_MAGIC, 4) != 0)
+    {
+        throw ImageE_QOI(filename, "Not a QOI file.");
+    }
 
-    rval.width = image.get_width();
-    rval.height = image.get_height();
-    rval.pixels.clear();
-    rval.pixels.reserve(rval.width*rval.height);
+    const std::uint32_t w = readBE(&data[4]);
+    const std::uint32_t h = readBE(&data[8]);
+    const int channels = data[12];
 
-    for (int r=0; r<rval.height; ++r)
+    if (w == 0 || h == 0 || h >= QOI_PIXELS_MAX/w || (channels != 3 && channels != 4))
     {
-        for (int c=0; c<rval.width; ++c)
+        throw ImageE_QOI(filename, "Invalid header.");
+    }
+
+    Image rval(w, h);
+
+    // Every op is at most 5 bytes, and the end marker is 8 bytes, so ops
+    // that start before the marker can be read without further checks.
+    const unsigned char* p = data.data()+QOI_HEADER;
+    const unsigned char* const end = data.data()+data.size()-sizeof(QOI_END);
+
+    SubPixel index[64][4] = {};
+    SubPixel px[4] = {0, 0, 0, 255};
+    int run = 0;
+
+    for (std::uint32_t r=0; r<h; ++r)
+    {
+        SubPixel* out = &rval[h-r-1][0][0];
+        SubPixel* const rowEnd = out+w*4;
+
+        for (; out != rowEnd; out+=4)
         {
-            auto&& p = image.get_pixel(c, rval.height-r-1);
-            rval.pixels.emplace_back(p.red, p.green, p.blue, p.alpha);
+            if (run > 0)
+            {
+                --run;
+            }
+            else
+            {
+                if (p >= end) throw ImageE_QOI(filename, "Truncated data.");
+
+                const unsigned char b1 = *p++;
+
+                if (b1 == QOI_OP_RGB)
+                {
+                    px[0] = p[0];
+                    px[1] = p[1];
+                    px[2] = p[2];
+                    p += 3;
+                }
+                else if (b1 == QOI_OP_RGBA)
+                {
+                    std::memcpy(px, p, 4);
+                    p += 4;
+                }
+                else
+                {
+                    switch (b1 & QOI_MASK)
+                    {
+                        case QOI_OP_INDEX:
+                            std::memcpy(px, index[b1], 4);
+                            break;
+                        case QOI_OP_DIFF:
+                            px[0] += ((b1 >> 4) & 3) - 2;
+                            px[1] += ((b1 >> 2) & 3) - 2;
+                            px[2] += ( b1       & 3) - 2;
+                            break;
+                        case QOI_OP_LUMA:
+                        {
+                            const unsigned char b2 = *p++;
+                            const int dg = (b1 & 0x3f) - 32;
+                            px[0] += dg - 8 + ((b2 >> 4) & 0x0f);
+                            px[1] += dg;
+                            px[2] += dg - 8 + ( b2       & 0x0f);
+                            break;
+                        }
+                        default:
+                            run = b1 & 0x3f;
+                            break;
+                    }
+                }
+
+                std::memcpy(index[qoiHash(px)], px, 4);
+            }
+
+            std::memcpy(out, px, 4);
         }
     }
 
     return rval;
 }
 
-Image Image::fromNoise(int w, int h) //static
+std::vector<unsigned char> encodeQOI(ConstImageView img)
 {
-    Image rval(w, h);
+    const int w = img.width;
+    const int h = img.height;
+
+    std::vector<unsigned char> rval(QOI_HEADER + std::size_t(w)*h*5 + sizeof(QOI_END));
+    unsigned char* out = rval.data();
 
-    std::mt19937 rng;
-    std::uniform_int_distribution<int> roll(0,255);
+    std::memcpy(out, QOI_MAGIC, 4);
+    writeBE(out+4, w);
+    writeBE(out+8, h);
+    out[12] = 4;
+    out[13] = 0;
+    out += QOI_HEADER;
 
-    for (int i=0; i<w; ++i)
+    std::uint32_t index[64] = {};
+    SubPixel prev[4] = {0, 0, 0, 255};
+    std::uint32_t prevBits;
+    std::memcpy(&prevBits, prev, 4);
+    int run = 0;
+
+    for (int r=h-1; r>=0; --r)
     {
-        for (int j=0; j<h; ++j)
+        const SubPixel* px = &img[r][0][0];
+
+        for (int c=0; c<w; ++c, px+=4)
         {
-            for (int k=0; k<4; ++k)
+            std::uint32_t bits;
+            std::memcpy(&bits, px, 4);
+
+            if (bits == prevBits)
+            {
+                if (++run == 62)
+                {
+                    *out++ = QOI_OP_RUN | (run-1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                *out++ = QOI_OP_RUN | (run-1);
+                run = 0;
+            }
+
+            const int slot = qoiHash(px);
+
+            if (index[slot] == bits)
+            {
+                *out++ = QOI_OP_INDEX | slot;
+            }
+            else
             {
-                rval.at(j,i)[k] = roll(rng);
+                index[slot] = bits;
+
+                if (px[3] == prev[3])
+                {
+                    const signed char dr = px[0]-prev[0];
+                    const signed char dg = px[1]-prev[1];
+                    const signed char db = px[2]-prev[2];
+                    const signed char drdg = dr-dg;
+                    const signed char dbdg = db-dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    {
+                        *out++ = QOI_OP_DIFF | (dr+2) << 4 | (dg+2) << 2 | (db+2);
+                    }
+                    else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7)
+                    {
+                        *out++ = QOI_OP_LUMA | (dg+32);
+                        *out++ = (drdg+8) << 4 | (dbdg+8);
+                    }
+                    else
+                    {
+                        *out++ = QOI_OP_RGB;
+                        *out++ = px[0];
+                        *out++ = px[1];
+                        *out++ = px[2];
+                    }
+                }
+                else
+                {
+                    *out++ = QOI_OP_RGBA;
+                    std::memcpy(out, px, 4);
+                    out += 4;
+                }
             }
+
+            std::memcpy(prev, px, 4);
+            prevBits = bits;
         }
     }
 
+    if (run > 0) *out++ = QOI_OP_RUN | (run-1);
+
+    std::memcpy(out, QOI_END, sizeof(QOI_END));
+    out += sizeof(QOI_END);
+
+    rval.resize(out-rval.data());
     return rval;
 }
 
+} // namespace
+
+Image Image::fromQOI(const std::string& filename) //static
+{
+    return decodeQOI(filename, readFile(filename));
+}
+
+Image Image::fromFile(const std::string& filename) //static
+{
+    unsigned char sig[8] = {};
+    {
+        std::ifstream in(filename.c_str(), std::ios::binary);
+        if (!in) throw ImageE_Format(filename);
+        in.read(reinterpret_cast<char*>(sig), sizeof(sig));
+    }
+
+    if (png_sig_cmp(sig, 0, 8) == 0) return fromPNG(filename);
+    if (std::memcmp(sig, QOI_MAGIC, 4) == 0) return fromQOI(filename);
+    if (std::memcmp(sig, "INUTILES", 8) == 0) return fromMapped(filename);
+
+    throw ImageE_Format(filename);
+}
+
+Image Image::fromMapped(const std::string& filename, int level) //static
+{
+    return MappedImage(filename).getImage(level);
+}
+
+Image Image::fromNoise(int w, int h, unsigned seed) //static
+{
+    return Noise(Noise::Type::WHITE, seed).generate(w, h);
+}
+
+Image::Image()
+    : width(0)
+    , height(0)
+    , pixels(std::make_shared<Buffer>())
+{}
+
+Image::Image(ConstImageView in)
+    : width(in.width)
+    , height(in.height)
+    , pixels(std::make_shared<Buffer>(in.width*in.height))
+{
+    blit(in, *this);
+}
+
 Image::Image(int w, int h)
     : width(w)
     , height(h)
-    , pixels(w*h, {255, 255, 255, 255})
+    , pixels(std::make_shared<Buffer>(w*h, Pixel{255, 255, 255, 255}))
 {}
 
 Image::Image(int w, int h, const Pixel& color)
     : width(w)
     , height(h)
-    , pixels(w*h, color)
+    , pixels(std::make_shared<Buffer>(w*h, color))
 {}
 
 Pixel& Image::at(int x, int y) &
@@ -124,7 +757,8 @@ Pixel& Image::at(int x, int y) &
     {
         throw ImageE_OutOfBounds(*this, x, y);
     }
-    return pixels[y*width+x];
+    detach();
+    return (*pixels)[y*width+x];
 }
 
 const Pixel& Image::at(int x, int y) const&
@@ -133,132 +767,531 @@ const Pixel& Image::at(int x, int y) const&
     {
         throw ImageE_OutOfBounds(*this, x, y);
     }
-    return pixels[y*width+x];
+    return (*pixels)[y*width+x];
 }
 
 Pixel* Image::operator[](int y) &
 {
-    return &pixels[y*width];
+    detach();
+    return pixels->data()+y*width;
 }
 
 const Pixel* Image::operator[](int y) const&
 {
-    return &pixels[y*width];
+    return pixels->data()+y*width;
+}
+
+ImageView Image::view() &
+{
+    detach();
+    return ImageView(pixels->data(), width, height, width);
+}
+
+ConstImageView Image::view() const&
+{
+    return ConstImageView(pixels->data(), width, height, width);
+}
+
+Image::operator ImageView() &
+{
+    return view();
+}
+
+Image::operator ConstImageView() const&
+{
+    return view();
 }
 
 void Image::resize(int w, int h)
 {
     width  = w;
     height = h;
-    pixels.resize(width*height);
+
+    // The contents are invalidated anyway, so shared pixels aren't copied.
+    if (!pixels || pixels.use_count() > 1) pixels = std::make_shared<Buffer>(width*height);
+    else pixels->resize(width*height);
 }
 
-Image blur(Image img)
+void Image::toPNG(const std::string& filename, int level) const
 {
-    Image rval(img.width, img.height, {0, 0, 0, 0});
+    if (width == 0 || height == 0) throw ImageE_PNG(filename, "Image is empty.");
 
-    double coeffs[3][3] = {
-          {0.10, 0.10, 0.10}
-        , {0.10, 0.20, 0.10}
-        , {0.10, 0.10, 0.10}
-    };
+    const int n = width*sizeof(Pixel);
+    const std::vector<SubPixel> zero (n);
 
-    auto pick = [&](int x, int y) -> Pixel&
+    // Bands are kept at least two windows long, so priming each band with
+    // the previous one is worthwhile.
+    auto&& pool = ThreadPool::global();
+    const int band = pool.getBandRows(height, n+1, std::max<int>(PNG_WINDOW*2/(n+1), 1));
+    const int bands = (height+band-1)/band;
+
+    std::vector<std::vector<SubPixel>> filtered (bands);
+    std::vector<std::vector<unsigned char>> packed (bands);
+    std::vector<uLong> sums (bands);
+    std::vector<char> ok (bands);
+
+    // PNG rows are stored top-down.
+    auto row = [&](int r)
     {
-        if (x<0) x=0;
-        else if (x>=img.width) x=img.width-1;
-        if (y<0) y=0;
-        else if (y>=img.height) y=img.height-1;
-        return img.at(x, y);
+        return &(*this)[height-r-1][0][0];
     };
 
-    for (int r=0; r<img.height; ++r)
+    pool.parallelFor(0, bands, [&](int b)
     {
-        for (int c=0; c<img.width; ++c)
+        const int y0 = b*band;
+        const int y1 = std::min(y0+band, int(height));
+
+        std::vector<SubPixel> scratch (n*PNG_FILTERS);
+        auto&& out = filtered[b];
+        out.resize((y1-y0)*(n+1));
+
+        for (int y=y0; y<y1; ++y)
         {
-            auto&& p = rval.at(c, r);
-            for (int rr=-1; rr<=1; ++rr)
+            filterRow(row(y), (y > 0)? row(y-1) : zero.data(), n, scratch, &out[(y-y0)*(n+1)]);
+        }
+
+        sums[b] = adler32(adler32(0, nullptr, 0), out.data(), out.size());
+    });
+
+    pool.parallelFor(0, bands, [&](int b)
+    {
+        ok[b] = deflateBand(filtered[b], (b > 0)? &filtered[b-1] : nullptr, level, b == bands-1, packed[b]);
+    });
+
+    if (std::count(ok.begin(), ok.end(), 0) > 0) throw ImageE_PNG(filename, "Could not compress image.");
+
+    uLong check = sums[0];
+    for (int b=1; b<bands; ++b) check = adler32_combine(check, sums[b], filtered[b].size());
+
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(PNG_SIGNATURE), sizeof(PNG_SIGNATURE));
+
+    // 8-bit RGBA, no interlacing.
+    unsigned char header[13] = {};
+    writeBE(header, width);
+    writeBE(header+4, height);
+    header[8] = 8;
+    header[9] = 6;
+    writeChunk(out, "IHDR", header, sizeof(header));
+
+    // The zlib header records the compression level, and must be a
+    // multiple of 31.
+    const int flevel = (level < 0)? 2 : (level < 2)? 0 : (level < 6)? 1 : (level == 6)? 2 : 3;
+    unsigned char zhead[2] = {0x78, SubPixel(flevel << 6)};
+    zhead[1] += 31 - (zhead[0]*256 + zhead[1]) % 31;
+    writeChunk(out, "IDAT", zhead, sizeof(zhead));
+
+    for (auto&& p : packed) writeChunk(out, "IDAT", p.data(), p.size());
+
+    unsigned char ztail[4];
+    writeBE(ztail, check);
+    writeChunk(out, "IDAT", ztail, sizeof(ztail));
+
+    writeChunk(out, "IEND", nullptr, 0);
+
+    if (!out) throw ImageE_PNG(filename, "Could not write file.");
+}
+
+void Image::toQOI(const std::string& filename) const
+{
+    const std::vector<unsigned char> data = encodeQOI(view());
+
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    if (!out) throw ImageE_QOI(filename, "Could not write file.");
+}
+
+void Image::save(const std::string& filename, bool mipmaps) const
+{
+    MappedImage::save(filename, view(), mipmaps);
+}
+
+void Image::transpose()
+{
+    if (width == height)
+    {
+        Inugami::transpose(view());
+        return;
+    }
+
+    Image rval(height, width);
+    Inugami::transpose(static_cast<const Image&>(*this).view(), rval);
+    *this = std::move(rval);
+}
+
+void Image::rotate90()
+{
+    if (width == height)
+    {
+        Inugami::transpose(view());
+        flipX(view());
+        return;
+    }
+
+    Image rval(height, width);
+    Inugami::rotate90(static_cast<const Image&>(*this).view(), rval);
+    *this = std::move(rval);
+}
+
+void Image::rotate270()
+{
+    if (width == height)
+    {
+        Inugami::transpose(view());
+        flipY(view());
+        return;
+    }
+
+    Image rval(height, width);
+    Inugami::rotate270(static_cast<const Image&>(*this).view(), rval);
+    *this = std::move(rval);
+}
+
+void Image::crop(int x, int y, int w, int h)
+{
+    ConstImageView region = static_cast<const Image&>(*this).view().sub(x, y, w, h);
+
+    if (pixels.use_count() > 1)
+    {
+        *this = Image(region);
+        return;
+    }
+
+    // Rows only move towards the front of the buffer, so no row is
+    // overwritten before it is copied.
+    Pixel* data = pixels->data();
+    for (int r=0; r<h; ++r)
+    {
+        const Pixel* row = region[r];
+        if (row != data+r*w) std::copy(row, row+w, data+r*w);
+    }
+
+    width  = w;
+    height = h;
+    pixels->resize(w*h);
+}
+
+void Image::detach()
+{
+    if (!pixels) pixels = std::make_shared<Buffer>();
+    else if (pixels.use_count() > 1) pixels = std::make_shared<Buffer>(*pixels);
+}
+
+void blit(ConstImageView src, ImageView dst)
+{
+    if (src.width > dst.width || src.height > dst.height)
+    {
+        throw ImageE_SizeMismatch(src.width, src.height, dst.width, dst.height);
+    }
+
+    for (int r=0; r<src.height; ++r)
+    {
+        std::copy(src[r], src[r]+src.width, dst[r]);
+    }
+}
+
+namespace {
+
+std::vector<float> gaussianKernel(int radius, double sigma)
+{
+    std::vector<float> rval(radius*2+1);
+
+    double sum = 0.0;
+    for (int i=-radius; i<=radius; ++i)
+    {
+        double w = std::exp(-(i*i)/(2.0*sigma*sigma));
+        rval[i+radius] = w;
+        sum += w;
+    }
+
+    for (auto&& w : rval) w /= sum;
+
+    return rval;
+}
+
+// Convolves a padded row of RGBA floats. The row must be extended by
+// (taps-1)/2 pixels on both sides, so no bounds checks are needed.
+void blurRow(const float* pad, float* out, int width, const float* kernel, int taps)
+{
+    int x = 0;
+
+#ifdef INU_SIMD_AVX2
+    for (; x+2<=width; x+=2)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (int k=0; k<taps; ++k)
+        {
+            __m256 p = _mm256_loadu_ps(pad+(x+k)*4);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(kernel[k]), p));
+        }
+        _mm256_storeu_ps(out+x*4, acc);
+    }
+#endif
+
+#ifdef INU_SIMD_SSE2
+    for (; x<width; ++x)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (int k=0; k<taps; ++k)
+        {
+            __m128 p = _mm_loadu_ps(pad+(x+k)*4);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel[k]), p));
+        }
+        _mm_storeu_ps(out+x*4, acc);
+    }
+#else
+    for (; x<width; ++x)
+    {
+        float acc[4] = {0.f, 0.f, 0.f, 0.f};
+        for (int k=0; k<taps; ++k)
+        {
+            const float* p = pad+(x+k)*4;
+            for (int i=0; i<4; ++i) acc[i] += kernel[k]*p[i];
+        }
+        for (int i=0; i<4; ++i) out[x*4+i] = acc[i];
+    }
+#endif
+}
+
+// Sums weighted rows of n floats and stores the result as bytes, rounded to
+// nearest even like the SIMD conversions.
+void blurColumn(const float* const* rows, const float* kernel, int taps, int n, SubPixel* out)
+{
+    int i = 0;
+
+#ifdef INU_SIMD_AVX2
+    for (; i+8<=n; i+=8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (int k=0; k<taps; ++k)
+        {
+            __m256 p = _mm256_loadu_ps(rows[k]+i);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(kernel[k]), p));
+        }
+        __m256i v = _mm256_cvtps_epi32(acc);
+        __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out+i), _mm_packus_epi16(w, w));
+    }
+#endif
+
+#ifdef INU_SIMD_SSE2
+    for (; i+4<=n; i+=4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (int k=0; k<taps; ++k)
+        {
+            __m128 p = _mm_loadu_ps(rows[k]+i);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel[k]), p));
+        }
+        __m128i v = _mm_cvtps_epi32(acc);
+        v = _mm_packs_epi32(v, v);
+        int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+        std::memcpy(out+i, &bytes, 4);
+    }
+#endif
+
+    for (; i<n; ++i)
+    {
+        float acc = 0.f;
+        for (int k=0; k<taps; ++k) acc += kernel[k]*rows[k][i];
+        out[i] = clamp(int(std::lrint(acc)), 0, 255);
+    }
+}
+
+} // namespace
+
+void blur(ConstImageView src, ImageView dst, int radius, double sigma)
+{
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        throw ImageE_SizeMismatch(src.width, src.height, dst.width, dst.height);
+    }
+
+    const int w = src.width;
+    const int h = src.height;
+
+    if (w == 0 || h == 0) return;
+
+    const bool inPlace = dst.sameAs(src);
+
+    if (radius < 1)
+    {
+        if (!inPlace) blit(src, dst);
+        return;
+    }
+
+    if (sigma <= 0.0) sigma = (radius+1)/2.0;
+
+    const int taps = radius*2+1;
+    const int n = w*4;
+    const auto kernel = gaussianKernel(radius, sigma);
+
+    auto&& pool = ThreadPool::global();
+    const int band = pool.getBandRows(h, n, radius*2);
+    const int bands = (h+band-1)/band;
+
+    // When blurring in place, each band reads rows that its neighbours
+    // overwrite, so those halo rows are copied before any band runs.
+    std::vector<std::vector<Pixel>> halos(inPlace ? bands : 0);
+    for (int b=0; b<int(halos.size()); ++b)
+    {
+        int y0 = b*band;
+        int y1 = std::min(y0+band, h);
+        int lo = std::max(y0-radius, 0);
+        int hi = std::min(y1+radius, h);
+        for (int y=lo; y<y0; ++y) halos[b].insert(halos[b].end(), src[y], src[y]+w);
+        for (int y=y1; y<hi; ++y) halos[b].insert(halos[b].end(), src[y], src[y]+w);
+    }
+
+    pool.parallelFor(0, bands, [&](int b)
+    {
+        const int y0 = b*band;
+        const int y1 = std::min(y0+band, h);
+        const int lo = std::max(y0-radius, 0);
+
+        auto source = [&](int y) -> const Pixel*
+        {
+            if (!inPlace || (y >= y0 && y < y1)) return src[y];
+            if (y < y0) return &halos[b][(y-lo)*w];
+            return &halos[b][(y0-lo+y-y1)*w];
+        };
+
+        // Horizontally blurred rows are kept in a ring buffer, so source
+        // rows are consumed before the destination rows overwrite them.
+        std::vector<float> pad((w+radius*2)*4);
+        std::vector<float> ring(taps*n);
+        std::vector<const float*> rows(taps);
+
+        auto horizontal = [&](int y)
+        {
+            const SubPixel* in = &source(y)[0][0];
+            const SubPixel* last = in+(w-1)*4;
+
+            for (int x=0; x<radius; ++x)
             {
-                for (int cc=-1; cc<=1; ++cc)
-                {
-                    p += pick(c+cc, r+rr) * coeffs[1+cc][1+rr];
-                }
+                std::copy(in  , in  +4, &pad[x*4]);
+                std::copy(last, last+4, &pad[(w+radius+x)*4]);
             }
+            std::copy(in, in+n, &pad[radius*4]);
+
+            blurRow(&pad[0], &ring[(y%taps)*n], w, &kernel[0], taps);
+        };
+
+        int next = lo;
+        for (int y=y0; y<y1; ++y)
+        {
+            for (; next <= std::min(y+radius, h-1); ++next) horizontal(next);
+
+            for (int k=0; k<taps; ++k)
+            {
+                int r = clamp(y+k-radius, 0, h-1);
+                rows[k] = &ring[(r%taps)*n];
+            }
+
+            blurColumn(&rows[0], &kernel[0], taps, n, &dst[y][0][0]);
         }
-    }
+    });
+}
 
+Image blur(ConstImageView img, int radius, double sigma)
+{
+    Image rval(img.width, img.height);
+    blur(img, rval, radius, sigma);
     return rval;
 }
 
-Image amplify(Image img)
+void amplify(ConstImageView src, ImageView dst)
 {
     class MinMax
     {
     public:
         MinMax()
-            : min(-1)
-            , max(0)
-            , dist(0.0)
+            : min{255, 255, 255, 255}
+            , max{0, 0, 0, 0}
         {}
 
-        void set(SubPixel p)
+        void set(const Pixel& p)
         {
-            if (p < min) min = p;
-            if (p > max) max = p;
+            for (int i=0; i<4; ++i)
+            {
+                if (p[i] < min[i]) min[i] = p[i];
+                if (p[i] > max[i]) max[i] = p[i];
+            }
         }
 
-        void setdist()
+        void merge(const MinMax& in)
         {
-            if (max-min == 0) return;
-            dist = 255.0/(max-min);
+            for (int i=0; i<4; ++i)
+            {
+                if (in.min[i] < min[i]) min[i] = in.min[i];
+                if (in.max[i] > max[i]) max[i] = in.max[i];
+            }
         }
 
-        SubPixel min;
-        SubPixel max;
-        double dist;
+        SubPixel min[4];
+        SubPixel max[4];
     };
 
-    MinMax red;
-    MinMax green;
-    MinMax blue;
-    MinMax alpha;
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        throw ImageE_SizeMismatch(src.width, src.height, dst.width, dst.height);
+    }
+
+    if (src.width == 0 || src.height == 0) return;
+
+    const int w = src.width;
+    const int h = src.height;
 
-    for (int r=0; r<img.height; ++r)
+    auto&& pool = ThreadPool::global();
+    const int band = pool.getBandRows(h, w*sizeof(Pixel));
+    const int bands = (h+band-1)/band;
+
+    // Parallel reduction: each band finds its own range, then they're merged.
+    std::vector<MinMax> ranges(bands);
+
+    pool.parallelFor(0, bands, [&](int b)
     {
-        for (int c=0; c<img.width; ++c)
+        for (int r=b*band; r<std::min((b+1)*band, h); ++r)
         {
-            auto&& p = img.at(c, r);
-            red  .set(p.r());
-            green.set(p.g());
-            blue .set(p.b());
-            alpha.set(p.a());
+            for (const Pixel* p = src[r], *e = p+w; p != e; ++p) ranges[b].set(*p);
         }
-    }
+    });
 
-    red  .setdist();
-    green.setdist();
-    blue .setdist();
-    alpha.setdist();
+    MinMax range;
+    for (auto&& r : ranges) range.merge(r);
 
-    auto calc = [](const MinMax& mm, SubPixel& p)
+    SubPixel table[4][256];
+    for (int i=0; i<4; ++i)
     {
-        if (mm.dist == 0.0) return;
-        p = double(p-mm.min)/mm.dist;
-    };
+        int lo = range.min[i];
+        int d  = range.max[i]-lo;
+        for (int v=0; v<256; ++v)
+        {
+            if (d == 0) table[i][v] = v;
+            else table[i][v] = clamp(((v-lo)*255+d/2)/d, 0, 255);
+        }
+    }
 
-    for (int r=0; r<img.height; ++r)
+    pool.parallelBands(h, w*sizeof(Pixel), [&](int y0, int y1)
     {
-        for (int c=0; c<img.width; ++c)
+        for (int r=y0; r<y1; ++r)
         {
-            auto&& p = img.at(c, r);
-            calc(red  , p.r());
-            calc(green, p.g());
-            calc(blue , p.b());
-            calc(alpha, p.a());
+            const Pixel* in = src[r];
+            Pixel* out = dst[r];
+            for (int c=0; c<w; ++c)
+            {
+                for (int i=0; i<4; ++i) out[c][i] = table[i][in[c][i]];
+            }
         }
-    }
+    });
+}
 
-    return img;
+Image amplify(ConstImageView img)
+{
+    Image rval(img.width, img.height);
+    amplify(img, rval);
+    return rval;
 }
 
 } // namespace Inugami
@@ -28,19 +28,58 @@
 #ifndef INUGAMI_IMAGE_H
 #define INUGAMI_IMAGE_H
 
+#include "exception.hpp"
+#include "imageview.hpp"
 #include "pixel.hpp"
 #include "utility.hpp"
 
-#include <png++/png.hpp>
-
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
 namespace Inugami {
 
+class ImageE_SizeMismatch
+    : public Exception
+{
+    std::string err;
+public:
+    ImageE_SizeMismatch(int sw, int sh, int dw, int dh)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::Image Exception: Size mismatch between "
+           << sw << "x" << sh << " source and "
+           << dw << "x" << dh << " destination."
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+/*! @brief Mutable view of RGBA8 pixels.
+ */
+using ImageView = BasicImageView<Pixel>;
+
+/*! @brief Read-only view of RGBA8 pixels.
+ */
+using ConstImageView = BasicImageView<const Pixel>;
+
 /*! @brief Container for pixel data.
  *
  *  Describes an image in RGBA8 format. Designed to be converted into a Texture.
+ *
+ *  Copies of an Image share their pixels until one of them is modified, so
+ *  Images are cheap to pass by value. Any non-const access to the pixels
+ *  gives the Image its own copy first.
+ *
+ *  @note Pointers to the pixels of an Image, including rows and views, may
+ *  refer to shared pixels after the Image is copied.
  */
 class Image
 {
@@ -54,7 +93,8 @@ public:
 
     /*! @brief Creates an Image from a PNG file.
      *
-     *  Loads the given PNG file into an Image.
+     *  Loads the given PNG file into an Image. Palette, grayscale, and 16-bit
+     *  images are converted to RGBA8 while decoding.
      *
      *  @param filename Name of PNG file to import.
      *
@@ -62,20 +102,65 @@ public:
      */
     static Image fromPNG(const std::string& filename);
 
+    /*! @brief Creates an Image from a QOI file.
+     *
+     *  QOI is a simple lossless format that decodes much faster than PNG.
+     *
+     *  @param filename Name of QOI file to import.
+     *
+     *  @return Image imported from the QOI file.
+     */
+    static Image fromQOI(const std::string& filename);
+
+    /*! @brief Creates an Image from a file in any supported format.
+     *
+     *  The format is detected from the contents of the file, so PNG, QOI,
+     *  and tiled image files can be swapped without changing the code that
+     *  loads them.
+     *
+     *  @param filename Name of file to import.
+     *
+     *  @return Image imported from the file.
+     */
+    static Image fromFile(const std::string& filename);
+
+    /*! @brief Creates an Image from a tiled image file.
+     *
+     *  Maps the given file and copies the tiles of one level into an Image.
+     *  Tiles are stored uncompressed, so no decoding is done.
+     *
+     *  @see MappedImage
+     *
+     *  @param filename Name of file written by save().
+     *  @param level Mip level to copy.
+     *
+     *  @return Image copied from the file.
+     */
+    static Image fromMapped(const std::string& filename, int level=0);
+
     /*! @brief Creates an Image from random noise.
      *
-     *  Creates an Image from random noise.
+     *  Creates an Image from white noise. See Noise for coherent noise.
      *
      *  @param w Width.
      *  @param h Height.
+     *  @param seed Random seed.
      *
      *  @return Image created from noise.
      */
-    static Image fromNoise(int w, int h);
+    static Image fromNoise(int w, int h, unsigned seed=0);
 
     /*! @brief Default contructor.
      */
-    Image() = default;
+    Image();
+
+    /*! @brief View constructor.
+     *
+     *  Copies the pixels of the given view into a new Image.
+     *
+     *  @param in View to copy.
+     */
+    explicit Image(ConstImageView in);
 
     /*! @brief Canvas constructor.
      *
@@ -130,15 +215,87 @@ public:
      */
     const Pixel* operator[](int y) const&;
 
+    /*! @brief Creates a mutable view of the whole Image.
+     */
+    ImageView view() &;
+
+    /*! @brief Creates a read-only view of the whole Image.
+     */
+    ConstImageView view() const&;
+
+    /*! @brief Converts to a mutable view.
+     */
+    operator ImageView() &;
+
+    /*! @brief Converts to a read-only view.
+     */
+    operator ConstImageView() const&;
+
     /*! @brief Changes the dimensions of the Image.
      *
-     *  @note Invalidates all contained Pixel%s.
+     *  @note Invalidates all contained Pixel%s. Use resample() to scale the
+     *  contents instead.
      *
      *  @param w New width.
      *  @param h New height.
      */
     void resize(int w, int h);
 
+    /*! @brief Saves the Image as a PNG file.
+     *
+     *  Rows are filtered and compressed in parallel, so large Images, such
+     *  as screenshots, can be saved without a long stall.
+     *
+     *  @param filename Name of file to write.
+     *  @param level Compression level, from 0 for fastest to 9 for smallest.
+     */
+    void toPNG(const std::string& filename, int level=6) const;
+
+    /*! @brief Saves the Image as a QOI file.
+     *
+     *  @param filename Name of file to write.
+     */
+    void toQOI(const std::string& filename) const;
+
+    /*! @brief Saves the Image as a tiled image file.
+     *
+     *  The file can be loaded quickly with fromMapped(), or mapped with
+     *  MappedImage.
+     *
+     *  @param filename Name of file to write.
+     *  @param mipmaps Also writes each halved level down to 1x1.
+     */
+    void save(const std::string& filename, bool mipmaps=true) const;
+
+    /*! @brief Transposes the Image, swapping its width and height.
+     *
+     *  Square Images are transposed in place.
+     */
+    void transpose();
+
+    /*! @brief Rotates the Image by 90 degrees counterclockwise.
+     *
+     *  Square Images are rotated in place.
+     */
+    void rotate90();
+
+    /*! @brief Rotates the Image by 270 degrees counterclockwise.
+     *
+     *  Square Images are rotated in place.
+     */
+    void rotate270();
+
+    /*! @brief Crops the Image to the given region.
+     *
+     *  Rows are moved in place unless the pixels are shared.
+     *
+     *  @param x X coordinate of the region.
+     *  @param y Y coordinate of the region.
+     *  @param w Width of the region.
+     *  @param h Height of the region.
+     */
+    void crop(int x, int y, int w, int h);
+
     /*! @brief Width of the image, in pixels.
      */
     Const<int> width;
@@ -148,16 +305,46 @@ public:
     Const<int> height;
 
 private:
-    std::vector<Pixel> pixels;
+    using Buffer = std::vector<Pixel>;
+
+    void detach();
+
+    std::shared_ptr<Buffer> pixels;
 };
 
-/*! @brief Blurs the image using a simple method.
+/*! @brief Copies pixels between views.
+ *
+ *  Copies @a src into the bottom-left corner of @a dst.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view, at least as large as @a src.
+ */
+void blit(ConstImageView src, ImageView dst);
+
+/*! @brief Applies a Gaussian blur.
+ *
+ *  The blur is separable, so the cost grows linearly with the radius. Edges
+ *  are extended by repeating the border pixels.
+ *
+ *  @note @a dst may be the same view as @a src, but must not otherwise
+ *  overlap it.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view, the same size as @a src.
+ *  @param radius Kernel radius, in pixels.
+ *  @param sigma Standard deviation, or 0 to use <tt>(radius+1)/2</tt>.
+ */
+void blur(ConstImageView src, ImageView dst, int radius=1, double sigma=0.0);
+
+/*! @brief Applies a Gaussian blur.
  *
- *  @param img Source image.
+ *  @param img Source view.
+ *  @param radius Kernel radius, in pixels.
+ *  @param sigma Standard deviation, or 0 to use <tt>(radius+1)/2</tt>.
  *
  *  @return Blurred image.
  */
-Image blur(Image img);
+Image blur(ConstImageView img, int radius=1, double sigma=0.0);
 
 /*! @brief Amplifies the image's colors.
  *
@@ -165,11 +352,20 @@ Image blur(Image img);
  *  maximum value is 1. Colors are scaled independently. If a color has only one
  *  value throughout the image, it will be unaffected.
  *
- *  @param img Source image.
+ *  @note @a dst may be the same view as @a src.
  *
- *  @return Blurred image.
+ *  @param src Source view.
+ *  @param dst Destination view, the same size as @a src.
+ */
+void amplify(ConstImageView src, ImageView dst);
+
+/*! @brief Amplifies the image's colors.
+ *
+ *  @param img Source view.
+ *
+ *  @return Amplified image.
  */
-Image amplify(Image img);
+Image amplify(ConstImageView img);
 
 } // namespace Inugami
 
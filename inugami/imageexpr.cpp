@@ -0,0 +1,468 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "imageexpr.hpp"
+
+#include "imageops.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Inugami {
+
+class ImageExpr::Node
+{
+public:
+    Node(int w, int h)
+        : width(w)
+        , height(h)
+    {}
+
+    virtual ~Node() = default;
+
+    /*! @brief Runs any passes over the whole image that eval() needs.
+     *
+     *  Called before any tiles are evaluated. Nodes must prepare their
+     *  inputs, too.
+     */
+    virtual void prepare() const
+    {}
+
+    /*! @brief Computes a region.
+     *
+     *  @param x X coordinate of the region.
+     *  @param y Y coordinate of the region.
+     *  @param out Destination, the size of the region.
+     */
+    virtual void eval(int x, int y, ImageView out) const = 0;
+
+    const int width;
+    const int height;
+};
+
+namespace {
+
+using Node = ImageExpr::Node;
+using NodePtr = std::shared_ptr<const Node>;
+
+// Tiles of 128x128 RGBA8 pixels take 64KiB, so a few of them fit in L2.
+constexpr int tileSize = 128;
+
+void checkSize(const Node& a, const Node& b)
+{
+    if (a.width != b.width || a.height != b.height)
+    {
+        throw ImageE_SizeMismatch(a.width, a.height, b.width, b.height);
+    }
+}
+
+// Evaluates every tile of a region in parallel.
+void forTiles(int x, int y, int w, int h, const std::function<void(int,int,int,int)>& func)
+{
+    const int tx = (w+tileSize-1)/tileSize;
+    const int ty = (h+tileSize-1)/tileSize;
+
+    ThreadPool::global().parallelFor(0, tx*ty, [&](int i)
+    {
+        const int x0 = (i%tx)*tileSize;
+        const int y0 = (i/tx)*tileSize;
+        func(x+x0, y+y0, std::min(tileSize, w-x0), std::min(tileSize, h-y0));
+    });
+}
+
+class SourceNode
+    : public Node
+{
+public:
+    SourceNode(Image in)
+        : Node(in.width, in.height)
+        , img(std::move(in))
+    {}
+
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        blit(img.view().sub(x, y, out.width, out.height), out);
+    }
+
+private:
+    const Image img;
+};
+
+class PointNode
+    : public Node
+{
+public:
+    using Op = std::function<void(ImageView)>;
+
+    PointNode(NodePtr i, Op o)
+        : Node(i->width, i->height)
+        , in(std::move(i))
+        , op(std::move(o))
+    {}
+
+    virtual void prepare() const override
+    {
+        in->prepare();
+    }
+
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        in->eval(x, y, out);
+        op(out);
+    }
+
+private:
+    NodePtr in;
+    Op op;
+};
+
+class BinaryNode
+    : public Node
+{
+public:
+    using Op = std::function<void(ConstImageView, ConstImageView, ImageView)>;
+
+    BinaryNode(NodePtr l, NodePtr r, Op o)
+        : Node(l->width, l->height)
+        , a(std::move(l))
+        , b(std::move(r))
+        , op(std::move(o))
+    {
+        checkSize(*a, *b);
+    }
+
+    virtual void prepare() const override
+    {
+        a->prepare();
+        b->prepare();
+    }
+
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        Image tmp (out.width, out.height);
+        a->eval(x, y, out);
+        b->eval(x, y, tmp);
+        op(out, tmp, out);
+    }
+
+private:
+    NodePtr a;
+    NodePtr b;
+    Op op;
+};
+
+class BlurNode
+    : public Node
+{
+public:
+    BlurNode(NodePtr i, int r, double s)
+        : Node(i->width, i->height)
+        , in(std::move(i))
+        , radius(std::max(r, 0))
+        , sigma(s)
+    {}
+
+    virtual void prepare() const override
+    {
+        in->prepare();
+    }
+
+    // Blurs the region grown by the radius. Where the grown region is
+    // clipped by the edge of the image, the blur repeats the same border
+    // pixels as it would on the whole image.
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        const int x0 = std::max(x-radius, 0);
+        const int y0 = std::max(y-radius, 0);
+        const int x1 = std::min(x+out.width+radius, width);
+        const int y1 = std::min(y+out.height+radius, height);
+
+        Image tmp (x1-x0, y1-y0);
+        in->eval(x0, y0, tmp);
+        blur(tmp, tmp, radius, sigma);
+        blit(tmp.view().sub(x-x0, y-y0, out.width, out.height), out);
+    }
+
+private:
+    NodePtr in;
+    int radius;
+    double sigma;
+};
+
+class AmplifyNode
+    : public Node
+{
+public:
+    AmplifyNode(NodePtr i)
+        : Node(i->width, i->height)
+        , in(std::move(i))
+        , once()
+        , cache()
+        , table()
+    {}
+
+    // The range of each color depends on the whole input, so the input is
+    // computed once, tile by tile, and kept. Then the same table as
+    // amplify() is built.
+    virtual void prepare() const override
+    {
+        in->prepare();
+
+        std::call_once(once, [&]
+        {
+            int lo[4] = {255, 255, 255, 255};
+            int hi[4] = {0, 0, 0, 0};
+            std::mutex mutex;
+
+            cache = Image(width, height);
+            const ImageView dst = cache;
+
+            forTiles(0, 0, width, height, [&](int x, int y, int w, int h)
+            {
+                const ImageView tmp = dst.sub(x, y, w, h);
+                in->eval(x, y, tmp);
+
+                int tlo[4] = {255, 255, 255, 255};
+                int thi[4] = {0, 0, 0, 0};
+                for (int r=0; r<h; ++r)
+                {
+                    const SubPixel* p = &tmp[r][0][0];
+                    for (int i=0; i<w*4; ++i)
+                    {
+                        tlo[i%4] = std::min<int>(tlo[i%4], p[i]);
+                        thi[i%4] = std::max<int>(thi[i%4], p[i]);
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int i=0; i<4; ++i)
+                {
+                    lo[i] = std::min(lo[i], tlo[i]);
+                    hi[i] = std::max(hi[i], thi[i]);
+                }
+            });
+
+            for (int i=0; i<4; ++i)
+            {
+                const int d = hi[i]-lo[i];
+                for (int v=0; v<256; ++v)
+                {
+                    if (d <= 0) table[i][v] = v;
+                    else table[i][v] = std::min(std::max(((v-lo[i])*255+d/2)/d, 0), 255);
+                }
+            }
+        });
+    }
+
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        const ConstImageView src = cache.view().sub(x, y, out.width, out.height);
+
+        for (int r=0; r<out.height; ++r)
+        {
+            const SubPixel* s = &src[r][0][0];
+            SubPixel* d = &out[r][0][0];
+            for (int i=0; i<out.width*4; i+=4)
+            {
+                d[i+0] = table[0][s[i+0]];
+                d[i+1] = table[1][s[i+1]];
+                d[i+2] = table[2][s[i+2]];
+                d[i+3] = table[3][s[i+3]];
+            }
+        }
+    }
+
+private:
+    NodePtr in;
+    mutable std::once_flag once;
+    mutable Image cache;
+    mutable SubPixel table[4][256];
+};
+
+class ResampleNode
+    : public Node
+{
+public:
+    ResampleNode(NodePtr i, int w, int h, ResampleFilter filter)
+        : Node(w, h)
+        , in(std::move(i))
+        , resampler(in->width, in->height, w, h, filter)
+    {}
+
+    virtual void prepare() const override
+    {
+        in->prepare();
+    }
+
+    virtual void eval(int x, int y, ImageView out) const override
+    {
+        if (in->width == 0 || in->height == 0) return;
+
+        int sx, sy, sw, sh;
+        resampler.getSource(x, y, out.width, out.height, sx, sy, sw, sh);
+
+        Image tmp (sw, sh);
+        in->eval(sx, sy, tmp);
+        resampler.apply(tmp, sx, sy, out, x, y);
+    }
+
+private:
+    NodePtr in;
+    Resampler resampler;
+};
+
+} // namespace
+
+ImageExpr::ImageExpr(Image img)
+    : node(std::make_shared<SourceNode>(std::move(img)))
+{}
+
+ImageExpr::ImageExpr(std::shared_ptr<const Node> n)
+    : node(std::move(n))
+{}
+
+int ImageExpr::getWidth() const
+{
+    return node->width;
+}
+
+int ImageExpr::getHeight() const
+{
+    return node->height;
+}
+
+Image ImageExpr::eval() const
+{
+    Image rval(node->width, node->height);
+    eval(rval);
+    return rval;
+}
+
+void ImageExpr::eval(ImageView dst, int x, int y) const
+{
+    if (x<0 || y<0 || x+dst.width>node->width || y+dst.height>node->height)
+    {
+        throw ImageViewE_OutOfBounds(x, y, dst.width, dst.height, node->width, node->height);
+    }
+
+    node->prepare();
+
+    forTiles(x, y, dst.width, dst.height, [&](int tx, int ty, int w, int h)
+    {
+        node->eval(tx, ty, dst.sub(tx-x, ty-y, w, h));
+    });
+}
+
+const std::shared_ptr<const ImageExpr::Node>& ImageExpr::getNode() const
+{
+    return node;
+}
+
+ImageExpr blur(ImageExpr in, int radius, double sigma)
+{
+    return ImageExpr(std::make_shared<BlurNode>(in.getNode(), radius, sigma));
+}
+
+ImageExpr amplify(ImageExpr in)
+{
+    return ImageExpr(std::make_shared<AmplifyNode>(in.getNode()));
+}
+
+ImageExpr resample(ImageExpr in, int w, int h, ResampleFilter filter)
+{
+    return ImageExpr(std::make_shared<ResampleNode>(in.getNode(), w, h, filter));
+}
+
+ImageExpr swizzle(ImageExpr in, Pixel::Color r, Pixel::Color g, Pixel::Color b, Pixel::Color a)
+{
+    return ImageExpr(std::make_shared<PointNode>(in.getNode(), [=](ImageView v)
+    {
+        swizzle(v, r, g, b, a, v);
+    }));
+}
+
+ImageExpr mix(ImageExpr a, ImageExpr b, float t)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(a.getNode(), b.getNode(), [=](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        mix(l, r, t, v);
+    }));
+}
+
+ImageExpr blend(ImageExpr src, ImageExpr back)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(src.getNode(), back.getNode(), [](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        blend(l, r, v);
+    }));
+}
+
+ImageExpr operator+(ImageExpr a, ImageExpr b)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(a.getNode(), b.getNode(), [](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        add(l, r, v);
+    }));
+}
+
+ImageExpr operator-(ImageExpr a, ImageExpr b)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(a.getNode(), b.getNode(), [](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        subtract(l, r, v);
+    }));
+}
+
+ImageExpr operator*(ImageExpr a, ImageExpr b)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(a.getNode(), b.getNode(), [](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        modulate(l, r, v);
+    }));
+}
+
+ImageExpr operator/(ImageExpr a, ImageExpr b)
+{
+    return ImageExpr(std::make_shared<BinaryNode>(a.getNode(), b.getNode(), [](ConstImageView l, ConstImageView r, ImageView v)
+    {
+        divide(l, r, v);
+    }));
+}
+
+ImageExpr operator*(ImageExpr a, float f)
+{
+    return ImageExpr(std::make_shared<PointNode>(a.getNode(), [=](ImageView v)
+    {
+        scale(v, f, v);
+    }));
+}
+
+} // namespace Inugami
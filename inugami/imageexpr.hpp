@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_IMAGEEXPR_H
+#define INUGAMI_IMAGEEXPR_H
+
+#include "image.hpp"
+#include "resample.hpp"
+
+#include <memory>
+
+namespace Inugami {
+
+/*! @brief Lazily evaluated image.
+ *
+ *  Describes how to compute an image from other images, without computing
+ *  it yet. Operations on ImageExpr%s build a graph, which is only evaluated
+ *  when eval() is called.
+ *
+ *  The graph is evaluated in tiles. Each tile is computed through the whole
+ *  graph before the next one is started, so intermediate results stay in
+ *  cache and no full-size temporaries are made. Per-pixel operations work in
+ *  place on the tile of their input. Stencils, such as blur(), compute a
+ *  slightly larger tile of their input, repeating the border between tiles.
+ *
+ *  Results are the same as the matching functions on views.
+ *
+ *  ImageExpr%s are immutable and cheap to copy.
+ */
+class ImageExpr
+{
+public:
+    /*! @brief Node of the graph.
+     */
+    class Node;
+
+    /*! @brief Image constructor.
+     *
+     *  The Image is copied, which shares its pixels until it is modified.
+     *
+     *  @param img Source image.
+     */
+    explicit ImageExpr(Image img);
+
+    /*! @brief Node constructor.
+     *
+     *  Used by the operations to build the graph.
+     *
+     *  @param n Root node.
+     */
+    explicit ImageExpr(std::shared_ptr<const Node> n);
+
+    int getWidth() const;
+    int getHeight() const;
+
+    /*! @brief Evaluates the whole image.
+     *
+     *  @return Computed image.
+     */
+    Image eval() const;
+
+    /*! @brief Evaluates a region of the image.
+     *
+     *  Only the tiles covering the region are computed.
+     *
+     *  @param dst Destination view. The region is the same size.
+     *  @param x X coordinate of the region.
+     *  @param y Y coordinate of the region.
+     */
+    void eval(ImageView dst, int x=0, int y=0) const;
+
+    /*! @brief Gets the root node.
+     */
+    const std::shared_ptr<const Node>& getNode() const;
+
+private:
+    std::shared_ptr<const Node> node;
+};
+
+/*! @brief Applies a Gaussian blur.
+ *
+ *  @see blur(ConstImageView,ImageView,int,double)
+ *
+ *  @param in Source expression.
+ *  @param radius Kernel radius, in pixels.
+ *  @param sigma Standard deviation, or 0 to use <tt>(radius+1)/2</tt>.
+ *
+ *  @return Blurred expression.
+ */
+ImageExpr blur(ImageExpr in, int radius=1, double sigma=0.0);
+
+/*! @brief Amplifies the image's colors.
+ *
+ *  The range of each color depends on the whole image, so @a in is computed
+ *  in full the first time the expression is evaluated, and kept.
+ *
+ *  @see amplify(ConstImageView,ImageView)
+ *
+ *  @param in Source expression.
+ *
+ *  @return Amplified expression.
+ */
+ImageExpr amplify(ImageExpr in);
+
+/*! @brief Resamples to a new size.
+ *
+ *  @see resample(ConstImageView,ImageView,ResampleFilter)
+ *
+ *  @param in Source expression.
+ *  @param w New width.
+ *  @param h New height.
+ *  @param filter Reconstruction filter.
+ *
+ *  @return Resampled expression.
+ */
+ImageExpr resample(ImageExpr in, int w, int h, ResampleFilter filter=ResampleFilter::BILINEAR);
+
+/*! @brief Rearranges the channels.
+ *
+ *  @see swizzle(ConstImageView,Pixel::Color,Pixel::Color,Pixel::Color,Pixel::Color,ImageView)
+ *
+ *  @param in Source expression.
+ *  @param r Source of the red channel.
+ *  @param g Source of the green channel.
+ *  @param b Source of the blue channel.
+ *  @param a Source of the alpha channel.
+ *
+ *  @return Swizzled expression.
+ */
+ImageExpr swizzle(ImageExpr in, Pixel::Color r, Pixel::Color g, Pixel::Color b, Pixel::Color a);
+
+/*! @brief Linearly interpolates between two expressions.
+ *
+ *  @param a Source expression at @a t=0.
+ *  @param b Source expression at @a t=1.
+ *  @param t Weight of @a b.
+ *
+ *  @return Interpolated expression.
+ */
+ImageExpr mix(ImageExpr a, ImageExpr b, float t);
+
+/*! @brief Alpha blends one expression over another.
+ *
+ *  @param src Foreground expression.
+ *  @param back Background expression.
+ *
+ *  @return Blended expression.
+ */
+ImageExpr blend(ImageExpr src, ImageExpr back);
+
+/*  Per-pixel arithmetic.
+ *
+ *  Gives the same results as the Pixel operators. Both operands must be the
+ *  same size.
+ */
+
+ImageExpr operator+(ImageExpr a, ImageExpr b);
+ImageExpr operator-(ImageExpr a, ImageExpr b);
+ImageExpr operator*(ImageExpr a, ImageExpr b);
+ImageExpr operator/(ImageExpr a, ImageExpr b);
+ImageExpr operator*(ImageExpr a, float f);
+
+} // namespace Inugami
+
+#endif // INUGAMI_IMAGEEXPR_H
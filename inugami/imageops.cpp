@@ -0,0 +1,367 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "imageops.hpp"
+
+#include "math.hpp"
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
+
+namespace Inugami {
+
+namespace {
+
+#ifdef INU_MM
+
+using SIMD::Vec;
+using SIMD::VecF;
+
+Vec load(const Pixel* p)
+{
+    return INU_SI(loadu)(reinterpret_cast<const Vec*>(p));
+}
+
+void store(Pixel* p, Vec v)
+{
+    INU_SI(storeu)(reinterpret_cast<Vec*>(p), v);
+}
+
+// Exact floor(x/255) for 16-bit lanes up to 255*255.
+Vec div255(Vec x)
+{
+    return INU_MM(srli_epi16)(INU_MM(mulhi_epu16)(x, INU_MM(set1_epi16)(short(0x8081))), 7);
+}
+
+// Exact round(x/255) for 16-bit lanes up to 255*255.
+Vec div255Round(Vec x)
+{
+    x = INU_MM(add_epi16)(x, INU_MM(set1_epi16)(128));
+    return INU_MM(srli_epi16)(INU_MM(add_epi16)(x, INU_MM(srli_epi16)(x, 8)), 8);
+}
+
+// Computes (a*wa + b*wb)/255 on 16-bit lanes, where wa+wb = 255.
+Vec weigh(Vec a, Vec wa, Vec b, Vec wb)
+{
+    return div255Round(INU_MM(add_epi16)(INU_MM(mullo_epi16)(a, wa), INU_MM(mullo_epi16)(b, wb)));
+}
+
+// Splits bytes into four vectors of floats, in an order that join() undoes.
+void split(Vec v, VecF out[4])
+{
+    const Vec z = INU_SI(setzero)();
+    const Vec lo = INU_MM(unpacklo_epi8)(v, z);
+    const Vec hi = INU_MM(unpackhi_epi8)(v, z);
+    out[0] = INU_MM(cvtepi32_ps)(INU_MM(unpacklo_epi16)(lo, z));
+    out[1] = INU_MM(cvtepi32_ps)(INU_MM(unpackhi_epi16)(lo, z));
+    out[2] = INU_MM(cvtepi32_ps)(INU_MM(unpacklo_epi16)(hi, z));
+    out[3] = INU_MM(cvtepi32_ps)(INU_MM(unpackhi_epi16)(hi, z));
+}
+
+// Truncates floats already clamped to [0,255] and packs them into bytes.
+Vec join(const VecF in[4])
+{
+    const Vec lo = INU_MM(packs_epi32)(INU_MM(cvttps_epi32)(in[0]), INU_MM(cvttps_epi32)(in[1]));
+    const Vec hi = INU_MM(packs_epi32)(INU_MM(cvttps_epi32)(in[2]), INU_MM(cvttps_epi32)(in[3]));
+    return INU_MM(packus_epi16)(lo, hi);
+}
+
+#endif // INU_MM
+
+struct AddOp
+{
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return a+b;
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a, Vec b) const
+    {
+        return INU_MM(adds_epu8)(a, b);
+    }
+#endif
+};
+
+struct SubtractOp
+{
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return a-b;
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a, Vec b) const
+    {
+        return INU_MM(subs_epu8)(a, b);
+    }
+#endif
+};
+
+struct ModulateOp
+{
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return a*b;
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a, Vec b) const
+    {
+        const Vec z = INU_SI(setzero)();
+        const Vec lo = INU_MM(mullo_epi16)(INU_MM(unpacklo_epi8)(a, z), INU_MM(unpacklo_epi8)(b, z));
+        const Vec hi = INU_MM(mullo_epi16)(INU_MM(unpackhi_epi8)(a, z), INU_MM(unpackhi_epi8)(b, z));
+        return INU_MM(packus_epi16)(div255(lo), div255(hi));
+    }
+#endif
+};
+
+struct DivideOp
+{
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return a/b;
+    }
+
+#ifdef INU_MM
+    // The quotient is at least 1/255 away from the next integer below 256,
+    // so truncating the rounded float quotient matches integer division.
+    // Division by 0 gives inf or NaN, both of which min() turns into 255.
+    Vec operator()(Vec a, Vec b) const
+    {
+        VecF fa[4];
+        VecF fb[4];
+        split(a, fa);
+        split(b, fb);
+        const VecF k = INU_MM(set1_ps)(255.f);
+        for (int i=0; i<4; ++i)
+        {
+            fa[i] = INU_MM(min_ps)(INU_MM(div_ps)(INU_MM(mul_ps)(fa[i], k), fb[i]), k);
+        }
+        return join(fa);
+    }
+#endif
+};
+
+struct ScaleOp
+{
+    float f;
+
+    Pixel operator()(const Pixel& a) const
+    {
+        return a*f;
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a) const
+    {
+        VecF fa[4];
+        split(a, fa);
+        const VecF k = INU_MM(set1_ps)(f);
+        const VecF low = INU_MM(setzero_ps)();
+        const VecF high = INU_MM(set1_ps)(255.f);
+        for (int i=0; i<4; ++i)
+        {
+            fa[i] = INU_MM(max_ps)(INU_MM(min_ps)(INU_MM(mul_ps)(fa[i], k), high), low);
+        }
+        return join(fa);
+    }
+#endif
+};
+
+struct MixOp
+{
+    float t;
+
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return mix(a, b, t);
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a, Vec b) const
+    {
+        const Vec z = INU_SI(setzero)();
+        const Vec wb = INU_MM(set1_epi16)(short(clamp(int(t*255.f+0.5f), 0, 255)));
+        const Vec wa = INU_MM(sub_epi16)(INU_MM(set1_epi16)(255), wb);
+        const Vec lo = weigh(INU_MM(unpacklo_epi8)(a, z), wa, INU_MM(unpacklo_epi8)(b, z), wb);
+        const Vec hi = weigh(INU_MM(unpackhi_epi8)(a, z), wa, INU_MM(unpackhi_epi8)(b, z), wb);
+        return INU_MM(packus_epi16)(lo, hi);
+    }
+#endif
+};
+
+struct BlendOp
+{
+    Pixel operator()(const Pixel& a, const Pixel& b) const
+    {
+        return blend(a, b);
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a, Vec b) const
+    {
+        auto half = [](Vec s, Vec d)
+        {
+            const Vec sa = INU_MM(shufflehi_epi16)(INU_MM(shufflelo_epi16)(s, 0xFF), 0xFF);
+            const Vec da = INU_MM(sub_epi16)(INU_MM(set1_epi16)(255), sa);
+            return weigh(s, sa, d, da);
+        };
+        const Vec z = INU_SI(setzero)();
+        const Vec lo = half(INU_MM(unpacklo_epi8)(a, z), INU_MM(unpacklo_epi8)(b, z));
+        const Vec hi = half(INU_MM(unpackhi_epi8)(a, z), INU_MM(unpackhi_epi8)(b, z));
+        return INU_MM(packus_epi16)(lo, hi);
+    }
+#endif
+};
+
+struct SwizzleOp
+{
+    Pixel::Color channels[4];
+
+    Pixel operator()(const Pixel& a) const
+    {
+        return Pixel(a[channels[0]], a[channels[1]], a[channels[2]], a[channels[3]]);
+    }
+
+#ifdef INU_MM
+    Vec operator()(Vec a) const
+    {
+        const Vec mask = INU_MM(set1_epi32)(0xff);
+        Vec rval = INU_SI(setzero)();
+        for (int i=0; i<4; ++i)
+        {
+            const Vec c = INU_SI(and)(INU_MM(srl_epi32)(a, _mm_cvtsi32_si128(channels[i]*8)), mask);
+            rval = INU_SI(or)(rval, INU_MM(sll_epi32)(c, _mm_cvtsi32_si128(i*8)));
+        }
+        return rval;
+    }
+#endif
+};
+
+void checkSize(ConstImageView src, ImageView dst)
+{
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        throw ImageE_SizeMismatch(src.width, src.height, dst.width, dst.height);
+    }
+}
+
+template <typename Op>
+void apply(ConstImageView a, ConstImageView b, ImageView dst, const Op& op)
+{
+    checkSize(a, dst);
+    checkSize(b, dst);
+
+    const int w = dst.width;
+
+    ThreadPool::global().parallelBands(dst.height, w*sizeof(Pixel), [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y)
+        {
+            const Pixel* ra = a[y];
+            const Pixel* rb = b[y];
+            Pixel* rd = dst[y];
+            int x = 0;
+#ifdef INU_MM
+            for (; x+int(sizeof(Vec)/sizeof(Pixel))<=w; x+=sizeof(Vec)/sizeof(Pixel))
+            {
+                store(rd+x, op(load(ra+x), load(rb+x)));
+            }
+#endif
+            for (; x<w; ++x) rd[x] = op(ra[x], rb[x]);
+        }
+    });
+}
+
+template <typename Op>
+void apply(ConstImageView src, ImageView dst, const Op& op)
+{
+    checkSize(src, dst);
+
+    const int w = dst.width;
+
+    ThreadPool::global().parallelBands(dst.height, w*sizeof(Pixel), [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y)
+        {
+            const Pixel* rs = src[y];
+            Pixel* rd = dst[y];
+            int x = 0;
+#ifdef INU_MM
+            for (; x+int(sizeof(Vec)/sizeof(Pixel))<=w; x+=sizeof(Vec)/sizeof(Pixel))
+            {
+                store(rd+x, op(load(rs+x)));
+            }
+#endif
+            for (; x<w; ++x) rd[x] = op(rs[x]);
+        }
+    });
+}
+
+} // namespace
+
+void add(ConstImageView a, ConstImageView b, ImageView dst)
+{
+    apply(a, b, dst, AddOp());
+}
+
+void subtract(ConstImageView a, ConstImageView b, ImageView dst)
+{
+    apply(a, b, dst, SubtractOp());
+}
+
+void modulate(ConstImageView a, ConstImageView b, ImageView dst)
+{
+    apply(a, b, dst, ModulateOp());
+}
+
+void divide(ConstImageView a, ConstImageView b, ImageView dst)
+{
+    apply(a, b, dst, DivideOp());
+}
+
+void scale(ConstImageView src, float f, ImageView dst)
+{
+    apply(src, dst, ScaleOp{f});
+}
+
+void mix(ConstImageView a, ConstImageView b, float t, ImageView dst)
+{
+    apply(a, b, dst, MixOp{t});
+}
+
+void blend(ConstImageView src, ConstImageView back, ImageView dst)
+{
+    apply(src, back, dst, BlendOp());
+}
+
+void swizzle(ConstImageView src, Pixel::Color r, Pixel::Color g, Pixel::Color b, Pixel::Color a, ImageView dst)
+{
+    apply(src, dst, SwizzleOp{{r, g, b, a}});
+}
+
+} // namespace Inugami
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_IMAGEOPS_H
+#define INUGAMI_IMAGEOPS_H
+
+#include "image.hpp"
+
+namespace Inugami {
+
+/*  Per-pixel arithmetic over whole views.
+ *
+ *  Each function gives the same result as applying the matching Pixel
+ *  operator to every pixel. Sources and destination must be the same size,
+ *  and the destination may be the same view as either source.
+ */
+
+/*! @brief Adds two views, saturating at 255.
+ *
+ *  @param a First source view.
+ *  @param b Second source view.
+ *  @param dst Destination view.
+ */
+void add(ConstImageView a, ConstImageView b, ImageView dst);
+
+/*! @brief Subtracts one view from another, saturating at 0.
+ *
+ *  @param a Source view to subtract from.
+ *  @param b Source view to subtract.
+ *  @param dst Destination view.
+ */
+void subtract(ConstImageView a, ConstImageView b, ImageView dst);
+
+/*! @brief Multiplies two views, treating 255 as 1.0.
+ *
+ *  @param a First source view.
+ *  @param b Second source view.
+ *  @param dst Destination view.
+ */
+void modulate(ConstImageView a, ConstImageView b, ImageView dst);
+
+/*! @brief Divides one view by another, treating 255 as 1.0.
+ *
+ *  Division by 0 gives 255.
+ *
+ *  @param a Dividend view.
+ *  @param b Divisor view.
+ *  @param dst Destination view.
+ */
+void divide(ConstImageView a, ConstImageView b, ImageView dst);
+
+/*! @brief Multiplies a view by a constant.
+ *
+ *  @param src Source view.
+ *  @param f Factor.
+ *  @param dst Destination view.
+ */
+void scale(ConstImageView src, float f, ImageView dst);
+
+/*! @brief Linearly interpolates between two views.
+ *
+ *  @param a Source view at @a t=0.
+ *  @param b Source view at @a t=1.
+ *  @param t Weight of @a b.
+ *  @param dst Destination view.
+ */
+void mix(ConstImageView a, ConstImageView b, float t, ImageView dst);
+
+/*! @brief Alpha blends one view over another.
+ *
+ *  @param src Foreground view.
+ *  @param back Background view.
+ *  @param dst Destination view.
+ */
+void blend(ConstImageView src, ConstImageView back, ImageView dst);
+
+/*! @brief Rearranges the channels of a view.
+ *
+ *  Each channel of the destination is copied from the given channel of the
+ *  source. For example, ALPHA for every channel spreads a mask to gray.
+ *
+ *  @param src Source view.
+ *  @param r Source of the red channel.
+ *  @param g Source of the green channel.
+ *  @param b Source of the blue channel.
+ *  @param a Source of the alpha channel.
+ *  @param dst Destination view.
+ */
+void swizzle(ConstImageView src, Pixel::Color r, Pixel::Color g, Pixel::Color b, Pixel::Color a, ImageView dst);
+
+} // namespace Inugami
+
+#endif // INUGAMI_IMAGEOPS_H
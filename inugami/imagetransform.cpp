@@ -0,0 +1,310 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "imagetransform.hpp"
+
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Inugami {
+
+namespace {
+
+// Tile size, in pixels. Two 32x32 tiles fit in L1 with room to spare.
+const int TILE = 32;
+
+// A 4x4 block of pixels, stored as rows.
+#ifdef INU_SIMD_SSE2
+struct Block
+{
+    __m128i r[4];
+
+    void load(const Pixel* p, int stride)
+    {
+        for (int i=0; i<4; ++i)
+        {
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i*stride));
+        }
+    }
+
+    void store(Pixel* p, int stride) const
+    {
+        for (int i=0; i<4; ++i) storeRow(i, p+i*stride, false);
+    }
+
+    void storeRow(int i, Pixel* p, bool reverse) const
+    {
+        const __m128i v = (reverse? _mm_shuffle_epi32(r[i], _MM_SHUFFLE(0,1,2,3)) : r[i]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+
+    void transpose()
+    {
+        const __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+        const __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+        const __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+        const __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+        r[0] = _mm_unpacklo_epi64(t0, t1);
+        r[1] = _mm_unpackhi_epi64(t0, t1);
+        r[2] = _mm_unpacklo_epi64(t2, t3);
+        r[3] = _mm_unpackhi_epi64(t2, t3);
+    }
+};
+#else
+struct Block
+{
+    Pixel r[4][4];
+
+    void load(const Pixel* p, int stride)
+    {
+        for (int i=0; i<4; ++i) std::copy(p+i*stride, p+i*stride+4, r[i]);
+    }
+
+    void store(Pixel* p, int stride) const
+    {
+        for (int i=0; i<4; ++i) storeRow(i, p+i*stride, false);
+    }
+
+    void storeRow(int i, Pixel* p, bool reverse) const
+    {
+        if (reverse) std::reverse_copy(r[i], r[i]+4, p);
+        else std::copy(r[i], r[i]+4, p);
+    }
+
+    void transpose()
+    {
+        for (int i=0; i<4; ++i)
+        {
+            for (int j=i+1; j<4; ++j) std::swap(r[i][j], r[j][i]);
+        }
+    }
+};
+#endif
+
+// Swaps a row with the reverse of another row.
+void reverseSwap(Pixel* a, Pixel* b, int w)
+{
+    int i = 0;
+
+#ifdef INU_SIMD_SSE2
+    for (; i+4<=w; i+=4)
+    {
+        Block blk;
+        blk.r[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        blk.r[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+w-4-i));
+        blk.storeRow(1, a+i, true);
+        blk.storeRow(0, b+w-4-i, true);
+    }
+#endif
+
+    for (; i<w; ++i) std::swap(a[i], b[w-1-i]);
+}
+
+// Reverses a row.
+void reverseRow(Pixel* a, int w)
+{
+    int i = 0;
+    int j = w;
+
+#ifdef INU_SIMD_SSE2
+    for (; j-i>=8; i+=4, j-=4)
+    {
+        Block blk;
+        blk.r[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        blk.r[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+j-4));
+        blk.storeRow(1, a+i, true);
+        blk.storeRow(0, a+j-4, true);
+    }
+#endif
+
+    std::reverse(a+i, a+j);
+}
+
+/*  Copies src(x,y) to dst(x',y'), where x' is y or h-1-y, and y' is x or
+ *  w-1-x. Transposes and quarter turns are all special cases.
+ */
+void transposeInto(ConstImageView src, ImageView dst, bool mirrorX, bool mirrorY)
+{
+    const int w = src.width;
+    const int h = src.height;
+
+    if (dst.width != h || dst.height != w)
+    {
+        throw ImageE_SizeMismatch(h, w, dst.width, dst.height);
+    }
+
+    auto row = [&](int x)
+    {
+        return dst[mirrorY? w-1-x : x];
+    };
+
+    auto col = [&](int y)
+    {
+        return (mirrorX? h-1-y : y);
+    };
+
+    ThreadPool::global().parallelFor(0, (h+TILE-1)/TILE, [&](int t)
+    {
+        const int y0 = t*TILE;
+        const int y1 = std::min(y0+TILE, h);
+
+        for (int x0=0; x0<w; x0+=TILE)
+        {
+            const int x1 = std::min(x0+TILE, w);
+
+            int y = y0;
+            for (; y+4<=y1; y+=4)
+            {
+                // The first column of the block is y+3 when mirrored.
+                const int c = (mirrorX? h-4-y : y);
+
+                int x = x0;
+                for (; x+4<=x1; x+=4)
+                {
+                    Block blk;
+                    blk.load(src[y]+x, src.stride);
+                    blk.transpose();
+                    for (int j=0; j<4; ++j) blk.storeRow(j, row(x+j)+c, mirrorX);
+                }
+                for (; x<x1; ++x)
+                {
+                    for (int i=0; i<4; ++i) row(x)[col(y+i)] = src[y+i][x];
+                }
+            }
+            for (; y<y1; ++y)
+            {
+                for (int x=x0; x<x1; ++x) row(x)[col(y)] = src[y][x];
+            }
+        }
+    });
+}
+
+} // namespace
+
+void flipX(ImageView img)
+{
+    ThreadPool::global().parallelBands(img.height, img.width*sizeof(Pixel), [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y) reverseRow(img[y], img.width);
+    });
+}
+
+void flipY(ImageView img)
+{
+    const int h = img.height;
+
+    ThreadPool::global().parallelBands(h/2, img.width*sizeof(Pixel)*2, [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y) std::swap_ranges(img[y], img[y]+img.width, img[h-1-y]);
+    });
+}
+
+void rotate180(ImageView img)
+{
+    const int h = img.height;
+
+    ThreadPool::global().parallelBands(h/2, img.width*sizeof(Pixel)*2, [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y) reverseSwap(img[y], img[h-1-y], img.width);
+    });
+
+    if (h%2 == 1) reverseRow(img[h/2], img.width);
+}
+
+void transpose(ImageView img)
+{
+    const int n = img.width;
+
+    if (img.height != n)
+    {
+        throw ImageE_SizeMismatch(img.width, img.height, img.height, img.width);
+    }
+
+    const int n4 = n-n%4;
+    const int tiles = (n4+TILE-1)/TILE;
+    const int stride = img.stride;
+
+    // Each task owns one tile row and the tile column it mirrors onto, so
+    // tasks never touch the same pixels.
+    ThreadPool::global().parallelFor(0, tiles, [&](int ti)
+    {
+        const int y0 = ti*TILE;
+        const int y1 = std::min(y0+TILE, n4);
+
+        for (int x0=y0; x0<n4; x0+=TILE)
+        {
+            const int x1 = std::min(x0+TILE, n4);
+
+            for (int y=y0; y<y1; y+=4)
+            {
+                for (int x=std::max(x0, y); x<x1; x+=4)
+                {
+                    Block a;
+                    a.load(img[y]+x, stride);
+                    a.transpose();
+
+                    if (x == y)
+                    {
+                        a.store(img[y]+x, stride);
+                        continue;
+                    }
+
+                    Block b;
+                    b.load(img[x]+y, stride);
+                    b.transpose();
+                    a.store(img[x]+y, stride);
+                    b.store(img[y]+x, stride);
+                }
+            }
+        }
+    });
+
+    for (int y=n4; y<n; ++y)
+    {
+        for (int x=0; x<y; ++x) std::swap(img[y][x], img[x][y]);
+    }
+}
+
+void transpose(ConstImageView src, ImageView dst)
+{
+    transposeInto(src, dst, false, false);
+}
+
+void rotate90(ConstImageView src, ImageView dst)
+{
+    transposeInto(src, dst, true, false);
+}
+
+void rotate270(ConstImageView src, ImageView dst)
+{
+    transposeInto(src, dst, false, true);
+}
+
+} // namespace Inugami
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_IMAGETRANSFORM_H
+#define INUGAMI_IMAGETRANSFORM_H
+
+#include "image.hpp"
+
+namespace Inugami {
+
+/*  Flips, rotations, and transposes.
+ *
+ *  Rotations are counterclockwise, with the origin in the bottom-left corner
+ *  as in OpenGL. Work is split into cache-sized tiles, which are spread over
+ *  the global ThreadPool. Transposes move 4x4 blocks of pixels at once.
+ *
+ *  See Image::transpose(), Image::rotate90(), Image::rotate270(), and
+ *  Image::crop() for versions that resize an Image in place.
+ */
+
+/*! @brief Mirrors a view along the X axis, in place.
+ *
+ *  @param img View to flip.
+ */
+void flipX(ImageView img);
+
+/*! @brief Mirrors a view along the Y axis, in place.
+ *
+ *  @param img View to flip.
+ */
+void flipY(ImageView img);
+
+/*! @brief Rotates a view by 180 degrees, in place.
+ *
+ *  @param img View to rotate.
+ */
+void rotate180(ImageView img);
+
+/*! @brief Transposes a square view, in place.
+ *
+ *  @param img View to transpose, as wide as it is tall.
+ */
+void transpose(ImageView img);
+
+/*! @brief Transposes a view.
+ *
+ *  @note @a dst must not overlap @a src.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view, as wide as @a src is tall, and as tall as
+ *  @a src is wide.
+ */
+void transpose(ConstImageView src, ImageView dst);
+
+/*! @brief Rotates a view by 90 degrees.
+ *
+ *  @note @a dst must not overlap @a src.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view, as wide as @a src is tall, and as tall as
+ *  @a src is wide.
+ */
+void rotate90(ConstImageView src, ImageView dst);
+
+/*! @brief Rotates a view by 270 degrees.
+ *
+ *  @note @a dst must not overlap @a src.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view, as wide as @a src is tall, and as tall as
+ *  @a src is wide.
+ */
+void rotate270(ConstImageView src, ImageView dst);
+
+} // namespace Inugami
+
+#endif // INUGAMI_IMAGETRANSFORM_H
@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_IMAGEVIEW_H
+#define INUGAMI_IMAGEVIEW_H
+
+#include "exception.hpp"
+#include "utility.hpp"
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace Inugami {
+
+class ImageViewE_OutOfBounds
+    : public Exception
+{
+    std::string err;
+public:
+    ImageViewE_OutOfBounds(int x, int y, int w, int h, int vw, int vh)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::ImageView Exception: Region (" << x << "," << y
+           << ") " << w << "x" << h << " exceeds " << vw << "x" << vh
+           << " view."
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+/*! @brief Non-owning view of pixel data.
+ *
+ *  Refers to a rectangle of pixels that is stored elsewhere, such as in an
+ *  Image. Rows are @a stride pixels apart, so a view can describe a
+ *  sub-rectangle of a larger image without copying it.
+ *
+ *  @note A view does not keep its pixels alive.
+ *
+ *  @tparam T Pixel type, @a const for read-only views.
+ */
+template <typename T>
+class BasicImageView
+{
+    template <typename A>
+    using Const = ConstAttr<A,BasicImageView>;
+
+    template <typename U>
+    friend class BasicImageView;
+
+public:
+    /*! @brief A row of pixels.
+     */
+    using Row = T*;
+
+    /*! @brief Default constructor.
+     *
+     *  Constructs an empty view.
+     */
+    BasicImageView()
+        : width(0)
+        , height(0)
+        , stride(0)
+        , data(nullptr)
+    {}
+
+    /*! @brief Primary constructor.
+     *
+     *  @param d Pointer to the first pixel of the bottom row.
+     *  @param w Width.
+     *  @param h Height.
+     *  @param s Distance between rows, in pixels.
+     */
+    BasicImageView(T* d, int w, int h, int s)
+        : width(w)
+        , height(h)
+        , stride(s)
+        , data(d)
+    {}
+
+    /*! @brief Conversion constructor.
+     *
+     *  Allows a mutable view to be used as a read-only view.
+     */
+    template <typename U
+        , typename = typename std::enable_if<std::is_convertible<U*,T*>::value>::type
+    >
+    BasicImageView(const BasicImageView<U>& in)
+        : width(in.width.get())
+        , height(in.height.get())
+        , stride(in.stride.get())
+        , data(in.data)
+    {}
+
+    /*! @brief Access the row at the given location.
+     *
+     *  @param y Y coordinate.
+     *
+     *  @return Row of pixels.
+     */
+    Row operator[](int y) const
+    {
+        return data+y*stride;
+    }
+
+    /*! @brief Creates a view of a sub-rectangle.
+     *
+     *  @param x X coordinate of the left edge.
+     *  @param y Y coordinate of the bottom edge.
+     *  @param w Width.
+     *  @param h Height.
+     *
+     *  @return View of the given rectangle.
+     */
+    BasicImageView sub(int x, int y, int w, int h) const
+    {
+        if (x<0 || y<0 || w<0 || h<0 || x+w>width || y+h>height)
+        {
+            throw ImageViewE_OutOfBounds(x, y, w, h, width, height);
+        }
+        return BasicImageView(data+y*stride+x, w, h, stride);
+    }
+
+    /*! @brief Returns @a true if the rows are stored without gaps.
+     */
+    bool isContiguous() const
+    {
+        return (stride == width || height <= 1);
+    }
+
+    /*! @brief Returns @a true if both views refer to the same pixels.
+     */
+    template <typename U>
+    bool sameAs(const BasicImageView<U>& in) const
+    {
+        return (data == in.data && stride == in.stride);
+    }
+
+    Const<int> width;   //!< Width of the view, in pixels.
+    Const<int> height;  //!< Height of the view, in pixels.
+    Const<int> stride;  //!< Distance between rows, in pixels.
+
+private:
+    T* data;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_IMAGEVIEW_H
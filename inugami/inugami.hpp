@@ -36,15 +36,26 @@ class Core;
 class Exception;
 class Geometry;
 class Image;
+class ImageExpr;
+class IndexedImage;
 class Interface;
+class JobSystem;
+class MappedImage;
 class Mesh;
+class Noise;
 class Pixel;
 class Profiler;
+class Resampler;
+class Scheduler;
 class Shader;
 class ShaderProgram;
 class Spritesheet;
 class Texture;
+class TextureArray;
+class TextureResidency;
+class ThreadPool;
 class Transform;
+class UniformName;
 
 } // namespace Inugami
 
@@ -0,0 +1,407 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "jobsystem.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace Inugami {
+
+namespace {
+
+// System and deque index of the current worker thread.
+thread_local const JobSystem* workerSystem = nullptr;
+thread_local unsigned int workerIndex = 0;
+
+} // namespace
+
+class JobSystem::Task
+{
+public:
+    explicit Task(std::function<void()>&& f)
+        : func(std::move(f))
+        , pending(1)
+        , done(false)
+        , mutex()
+        , finished(false)
+        , dependents()
+        , error()
+        , self()
+    {}
+
+    std::function<void()> func;
+    std::atomic<int> pending;
+    std::atomic<bool> done;
+
+    std::mutex mutex;
+    bool finished;
+    std::vector<std::shared_ptr<Task>> dependents;
+
+    std::exception_ptr error;
+    std::shared_ptr<Task> self; // Keeps the task alive while it is queued.
+};
+
+/* Chase-Lev deque, as formulated for C11 atomics by Le, Pop, Cohen and
+ * Zappa Nardelli. Only the owner pushes and pops, at the bottom; any thread
+ * may steal from the top. The capacity is fixed; push() fails when full.
+ */
+class JobSystem::Deque
+{
+public:
+    Deque()
+        : top(0)
+        , bottom(0)
+        , buffer()
+    {
+        for (auto&& slot : buffer) slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    bool push(Task* task)
+    {
+        std::int64_t b = bottom.load(std::memory_order_relaxed);
+        std::int64_t t = top.load(std::memory_order_acquire);
+        if (b-t >= std::int64_t(CAPACITY)) return false;
+        buffer[b & (CAPACITY-1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b+1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Task* pop()
+    {
+        std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom.store(b+1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = buffer[b & (CAPACITY-1)].load(std::memory_order_relaxed);
+
+        if (t == b)
+        {
+            if (!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                task = nullptr;
+            }
+            bottom.store(b+1, std::memory_order_relaxed);
+        }
+
+        return task;
+    }
+
+    Task* steal()
+    {
+        std::int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return nullptr;
+
+        Task* task = buffer[t & (CAPACITY-1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        return task;
+    }
+
+private:
+    static constexpr std::size_t CAPACITY = 4096;
+
+    std::atomic<std::int64_t> top;
+    std::atomic<std::int64_t> bottom;
+    std::atomic<Task*> buffer[CAPACITY];
+};
+
+JobSystem::Job::Job()
+    : task()
+{}
+
+JobSystem::Job::Job(const std::shared_ptr<Task>& t)
+    : task(t)
+{}
+
+bool JobSystem::Job::isDone() const
+{
+    return (!task || task->done.load(std::memory_order_acquire));
+}
+
+JobSystem::JobSystem(unsigned int n)
+    : deques()
+    , owner(std::this_thread::get_id())
+    , injected()
+    , injectMutex()
+    , injectedCount(0)
+    , unfinished(0)
+    , epoch(0)
+    , sleepers(0)
+    , mutex()
+    , wake()
+    , stopping(false)
+    , workers()
+{
+    for (unsigned int i=0; i<=n; ++i)
+    {
+        deques.emplace_back(new Deque()); //! @todo make_unique
+    }
+
+    for (unsigned int i=1; i<=n; ++i)
+    {
+        workers.emplace_back([this, i]{ work(i); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    Deque* own = getDeque();
+
+    while (unfinished.load() > 0)
+    {
+        if (Task* task = find(own)) execute(task);
+        else std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (auto&& t : workers) t.join();
+}
+
+unsigned int JobSystem::getConcurrency() const
+{
+    return deques.size();
+}
+
+JobSystem::Job JobSystem::add(std::function<void()> func, const std::vector<Job>& deps)
+{
+    auto task = std::make_shared<Task>(std::move(func));
+    ++unfinished;
+
+    for (auto&& dep : deps)
+    {
+        if (!dep.task) continue;
+        std::lock_guard<std::mutex> lock(dep.task->mutex);
+        if (dep.task->finished) continue;
+        ++task->pending;
+        dep.task->dependents.push_back(task);
+    }
+
+    Job rval(task);
+    if (--task->pending == 0) push(std::move(task));
+    return rval;
+}
+
+void JobSystem::wait(const Job& job)
+{
+    if (!job.task) return;
+
+    Deque* own = getDeque();
+
+    while (!job.task->done.load(std::memory_order_acquire))
+    {
+        if (Task* task = find(own)) execute(task);
+        else std::this_thread::yield();
+    }
+
+    if (job.task->error) std::rethrow_exception(job.task->error);
+}
+
+void JobSystem::parallelFor(int begin, int end, const std::function<void(int)>& func)
+{
+    if (end <= begin) return;
+
+    long long count = end-begin;
+    int chunks = std::min<long long>(count, getConcurrency()*4);
+
+    if (chunks <= 1)
+    {
+        for (int i=begin; i<end; ++i) func(i);
+        return;
+    }
+
+    std::vector<Job> jobs;
+    jobs.reserve(chunks);
+
+    for (int c=0; c<chunks; ++c)
+    {
+        int b = begin + count*c/chunks;
+        int e = begin + count*(c+1)/chunks;
+        jobs.push_back(add([&func, b, e]
+        {
+            for (int i=b; i<e; ++i) func(i);
+        }));
+    }
+
+    // Every chunk must finish before func goes out of scope.
+    std::exception_ptr error;
+    for (auto&& job : jobs)
+    {
+        try
+        {
+            wait(job);
+        }
+        catch (...)
+        {
+            if (!error) error = std::current_exception();
+        }
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+JobSystem::Deque* JobSystem::getDeque()
+{
+    if (workerSystem == this) return deques[workerIndex].get();
+    if (std::this_thread::get_id() == owner) return deques[0].get();
+    return nullptr;
+}
+
+void JobSystem::push(std::shared_ptr<Task> task)
+{
+    Task* raw = task.get();
+    raw->self = std::move(task);
+
+    Deque* own = getDeque();
+
+    if (!own || !own->push(raw))
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.push_back(raw);
+        ++injectedCount;
+    }
+
+    ++epoch;
+
+    if (sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+}
+
+JobSystem::Task* JobSystem::find(Deque* own)
+{
+    if (own)
+    {
+        if (Task* task = own->pop()) return task;
+    }
+
+    if (injectedCount.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        if (!injected.empty())
+        {
+            Task* task = injected.front();
+            injected.pop_front();
+            --injectedCount;
+            return task;
+        }
+    }
+
+    // Start stealing at a different victim on every thread.
+    std::size_t count = deques.size();
+    std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    for (std::size_t i=0; i<count; ++i)
+    {
+        Deque* victim = deques[(start+i)%count].get();
+        if (victim == own) continue;
+        if (Task* task = victim->steal()) return task;
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(Task* raw)
+{
+    auto task = std::move(raw->self);
+
+    try
+    {
+        task->func();
+    }
+    catch (...)
+    {
+        task->error = std::current_exception();
+    }
+
+    task->func = nullptr;
+
+    std::vector<std::shared_ptr<Task>> dependents;
+
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->finished = true;
+        dependents.swap(task->dependents);
+    }
+
+    task->done.store(true, std::memory_order_release);
+
+    for (auto&& dep : dependents)
+    {
+        if (--dep->pending == 0) push(std::move(dep));
+    }
+
+    --unfinished;
+}
+
+void JobSystem::work(unsigned int index)
+{
+    workerSystem = this;
+    workerIndex = index;
+
+    Deque* own = deques[index].get();
+
+    while (!stopping)
+    {
+        std::uint32_t seen = epoch.load();
+
+        if (Task* task = find(own))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ++sleepers;
+        wake.wait(lock, [&]{ return stopping || epoch.load() != seen; });
+        --sleepers;
+    }
+}
+
+} // namespace Inugami
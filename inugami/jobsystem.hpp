@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_JOBSYSTEM_H
+#define INUGAMI_JOBSYSTEM_H
+
+#include "inugami.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Work-stealing job system.
+ *
+ *  Every worker, and the thread that constructed the system, owns a
+ *  Chase-Lev deque. Jobs added by one of these threads are pushed to its own
+ *  deque, and idle threads steal from the others. Jobs added by any other
+ *  thread go to a shared queue.
+ *
+ *  A job may depend on other jobs, in which case it is only queued once all
+ *  of them are finished. Waiting for a job runs other jobs in the meantime,
+ *  so jobs may wait for the jobs they spawn.
+ *
+ *  Unlike ThreadPool, which runs one loop at a time for data-parallel
+ *  kernels, any number of jobs may be in flight at once.
+ */
+class JobSystem
+{
+    class Task;
+    class Deque;
+
+public:
+    /*! @brief Job handle.
+     */
+    class Job
+    {
+        friend class JobSystem;
+    public:
+        /*! @brief Default constructor.
+         *
+         *  Constructs a handle that refers to no job, and counts as done.
+         */
+        Job();
+
+        /*! @brief Returns @a true if the job has finished.
+         */
+        bool isDone() const;
+
+    private:
+        explicit Job(const std::shared_ptr<Task>& t);
+
+        std::shared_ptr<Task> task;
+    };
+
+    /*! @brief Primary constructor.
+     *
+     *  @param workers Number of worker threads to start.
+     */
+    explicit JobSystem(unsigned int workers);
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /*! @brief Destructor.
+     *
+     *  Runs every remaining job, then stops the workers.
+     */
+    ~JobSystem();
+
+    /*! @brief Number of threads that run jobs.
+     *
+     *  This is the number of workers plus the owning thread.
+     */
+    unsigned int getConcurrency() const;
+
+    /*! @brief Adds a job.
+     *
+     *  @param func Function to run.
+     *  @param deps Jobs that must finish before this job runs.
+     *
+     *  @return Handle to the job.
+     */
+    Job add(std::function<void()> func, const std::vector<Job>& deps = {});
+
+    /*! @brief Waits for a job to finish.
+     *
+     *  Other jobs are run while waiting.
+     *
+     *  @param job Job to wait for.
+     *
+     *  @throw Anything thrown by the job.
+     */
+    void wait(const Job& job);
+
+    /*! @brief Runs a loop in parallel.
+     *
+     *  Calls @a func once for every index in <tt>[begin, end)</tt>, in no
+     *  particular order, and returns when all calls are finished. If a call
+     *  throws, the first exception is rethrown on the calling thread.
+     *
+     *  @param begin First index.
+     *  @param end One past the last index.
+     *  @param func Function to call.
+     */
+    void parallelFor(int begin, int end, const std::function<void(int)>& func);
+
+private:
+    Deque* getDeque();
+    void push(std::shared_ptr<Task> task);
+    Task* find(Deque* own);
+    void execute(Task* task);
+    void work(unsigned int index);
+
+    std::vector<std::unique_ptr<Deque>> deques;
+    std::thread::id owner;
+
+    std::deque<Task*> injected;
+    std::mutex injectMutex;
+    std::atomic<int> injectedCount;
+
+    std::atomic<int> unfinished;
+
+    std::atomic<std::uint32_t> epoch;
+    std::atomic<int> sleepers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+
+    std::vector<std::thread> workers;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_JOBSYSTEM_H
@@ -0,0 +1,416 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "mappedimage.hpp"
+
+#include "exception.hpp"
+#include "resample.hpp"
+#include "threadpool.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Inugami {
+
+class MappedImageException
+    : public Exception
+{
+    std::string err;
+public:
+    MappedImageException(const std::string& filename, const std::string& msg)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::MappedImage Exception: \"" << filename << "\": " << msg;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+namespace {
+
+/*  File layout, in host byte order:
+ *
+ *  Header
+ *  Level[levels]
+ *  Padding to 64 bytes
+ *  Tiles of level 0, then level 1, ...
+ */
+
+const char MAGIC[8] = {'I','N','U','T','I','L','E','S'};
+const std::uint32_t VERSION = 1;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t tileSize;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levels;
+    std::uint32_t reserved[9];
+};
+
+struct Level
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t tilesX;
+    std::uint32_t tilesY;
+    std::uint64_t offset; //!< Offset of the first tile.
+    std::uint64_t reserved;
+};
+
+static_assert(sizeof(Header) == 64, "Unexpected MappedImage header size.");
+static_assert(sizeof(Level) == 32, "Unexpected MappedImage level size.");
+
+std::uint64_t alignUp(std::uint64_t x)
+{
+    return (x+63) & ~std::uint64_t(63);
+}
+
+} // namespace
+
+class MappedImage::Shared
+{
+public:
+    Shared(const std::string& filename);
+    ~Shared();
+
+    std::string filename;
+    const unsigned char* data;
+    std::size_t size;
+    int tileSize;
+    std::size_t tileBytes;
+    std::vector<Level> levels;
+};
+
+MappedImage::Shared::Shared(const std::string& filename)
+    : filename(filename)
+    , data(nullptr)
+    , size(0)
+    , tileSize(0)
+    , tileBytes(0)
+    , levels()
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+          filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr
+        , OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) throw MappedImageException(filename, "Could not open file.");
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= LONGLONG(sizeof(Header)))
+    {
+        size = std::size_t(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (mapping)
+    {
+        data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw MappedImageException(filename, "Could not open file.");
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= off_t(sizeof(Header)))
+    {
+        size = std::size_t(st.st_size);
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) data = static_cast<const unsigned char*>(p);
+    }
+    close(fd);
+#endif
+
+    if (!data) throw MappedImageException(filename, "Could not map file.");
+
+    // The mapping is released by the destructor, which doesn't run if the
+    // constructor throws.
+    auto fail = [&](const char* msg)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<unsigned char*>(data), size);
+#endif
+        throw MappedImageException(filename, msg);
+    };
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) fail("Not a tiled image file.");
+    if (header.version != VERSION) fail("Unsupported version.");
+    if (header.tileSize == 0 || header.tileSize%4 != 0 || header.tileSize > 4096) fail("Invalid tile size.");
+    if (header.levels == 0 || header.levels > 32) fail("Invalid number of levels.");
+    if (sizeof(Header) + header.levels*sizeof(Level) > size) fail("Truncated directory.");
+
+    tileSize = header.tileSize;
+    tileBytes = std::size_t(tileSize)*tileSize*sizeof(Pixel);
+
+    levels.resize(header.levels);
+    std::memcpy(&levels[0], data+sizeof(Header), levels.size()*sizeof(Level));
+
+    if (levels[0].width != header.width || levels[0].height != header.height)
+    {
+        fail("Level 0 does not match the header.");
+    }
+
+    for (const Level& lvl : levels)
+    {
+        if (lvl.width == 0 || lvl.height == 0 || lvl.width > 1u<<24 || lvl.height > 1u<<24
+         || lvl.tilesX != (lvl.width+tileSize-1)/tileSize
+         || lvl.tilesY != (lvl.height+tileSize-1)/tileSize)
+        {
+            fail("Invalid level dimensions.");
+        }
+
+        // Compared without adding to the offset, so a huge offset can't wrap.
+        // The tile count is below 2^48 after the dimension checks.
+        std::uint64_t tiles = std::uint64_t(lvl.tilesX)*lvl.tilesY;
+        if (lvl.offset%64 != 0 || lvl.offset > size
+         || tiles > (size - lvl.offset)/tileBytes)
+        {
+            fail("Truncated tile data.");
+        }
+    }
+}
+
+MappedImage::Shared::~Shared()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<unsigned char*>(data), size);
+#endif
+}
+
+void MappedImage::save(const std::string& filename, ConstImageView img, bool mipmaps, int tileSize) //static
+{
+    if (tileSize <= 0 || tileSize%4 != 0 || tileSize > 4096)
+    {
+        throw MappedImageException(filename, "Invalid tile size.");
+    }
+    if (img.width == 0 || img.height == 0)
+    {
+        throw MappedImageException(filename, "Cannot save an empty image.");
+    }
+
+    std::vector<Image> mips;
+    if (mipmaps)
+    {
+        ConstImageView prev = img;
+        while (prev.width > 1 || prev.height > 1)
+        {
+            mips.push_back(resample(prev, std::max(prev.width/2, 1), std::max(prev.height/2, 1)));
+            prev = mips.back();
+        }
+    }
+
+    auto levelView = [&](std::size_t i)
+    {
+        return (i == 0)? img : ConstImageView(mips[i-1]);
+    };
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.tileSize = tileSize;
+    header.width = img.width;
+    header.height = img.height;
+    header.levels = mips.size()+1;
+
+    const std::uint64_t tileBytes = std::uint64_t(tileSize)*tileSize*sizeof(Pixel);
+
+    std::vector<Level> levels(header.levels);
+    std::uint64_t offset = alignUp(sizeof(Header) + levels.size()*sizeof(Level));
+    for (std::size_t i=0; i<levels.size(); ++i)
+    {
+        ConstImageView v = levelView(i);
+        Level& lvl = levels[i];
+        lvl = Level();
+        lvl.width = v.width;
+        lvl.height = v.height;
+        lvl.tilesX = (v.width+tileSize-1)/tileSize;
+        lvl.tilesY = (v.height+tileSize-1)/tileSize;
+        lvl.offset = offset;
+        offset += std::uint64_t(lvl.tilesX)*lvl.tilesY*tileBytes;
+    }
+
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if (!out) throw MappedImageException(filename, "Could not open file for writing.");
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&levels[0]), levels.size()*sizeof(Level));
+
+    const std::vector<char> padding(levels[0].offset - sizeof(Header) - levels.size()*sizeof(Level), 0);
+    out.write(padding.data(), padding.size());
+
+    std::vector<Pixel> tile(tileSize*tileSize);
+    for (std::size_t i=0; i<levels.size(); ++i)
+    {
+        ConstImageView v = levelView(i);
+        for (std::uint32_t ty=0; ty<levels[i].tilesY; ++ty)
+        {
+            for (std::uint32_t tx=0; tx<levels[i].tilesX; ++tx)
+            {
+                const int x = tx*tileSize;
+                const int y = ty*tileSize;
+                const int w = std::min(tileSize, v.width-x);
+                const int h = std::min(tileSize, v.height-y);
+
+                std::fill(tile.begin(), tile.end(), Pixel(0, 0, 0, 0));
+                blit(v.sub(x, y, w, h), ImageView(tile.data(), tileSize, tileSize, tileSize));
+                out.write(reinterpret_cast<const char*>(tile.data()), tileBytes);
+            }
+        }
+    }
+
+    if (!out) throw MappedImageException(filename, "Failed to write file.");
+}
+
+MappedImage::MappedImage(const std::string& filename)
+    : share(std::make_shared<Shared>(filename))
+{}
+
+int MappedImage::getLevels() const
+{
+    return share->levels.size();
+}
+
+int MappedImage::getWidth(int level) const
+{
+    return share->levels.at(level).width;
+}
+
+int MappedImage::getHeight(int level) const
+{
+    return share->levels.at(level).height;
+}
+
+int MappedImage::getTileSize() const
+{
+    return share->tileSize;
+}
+
+int MappedImage::getTilesX(int level) const
+{
+    return share->levels.at(level).tilesX;
+}
+
+int MappedImage::getTilesY(int level) const
+{
+    return share->levels.at(level).tilesY;
+}
+
+ConstImageView MappedImage::getTile(int level, int tx, int ty) const
+{
+    const Level& lvl = share->levels.at(level);
+    const int ts = share->tileSize;
+
+    return ConstImageView(
+          tileData(level, tx, ty)
+        , std::min<int>(ts, lvl.width-tx*ts)
+        , std::min<int>(ts, lvl.height-ty*ts)
+        , ts
+    );
+}
+
+void MappedImage::prefetch(int level, int tx, int ty) const
+{
+#ifndef _WIN32
+    // madvise() needs a page-aligned address.
+    const long page = sysconf(_SC_PAGESIZE);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(tileData(level, tx, ty));
+    const std::size_t skew = (p - share->data) % page;
+    madvise(const_cast<unsigned char*>(p-skew), share->tileBytes+skew, MADV_WILLNEED);
+#else
+    tileData(level, tx, ty);
+#endif
+}
+
+Image MappedImage::getImage(int level) const
+{
+    const Level& lvl = share->levels.at(level);
+    const int ts = share->tileSize;
+
+    Image rval(lvl.width, lvl.height);
+    ImageView out = rval;
+
+    ThreadPool::global().parallelFor(0, lvl.tilesY, [&](int ty)
+    {
+        for (std::uint32_t tx=0; tx<lvl.tilesX; ++tx)
+        {
+            ConstImageView tile = getTile(level, tx, ty);
+            blit(tile, out.sub(tx*ts, ty*ts, tile.width, tile.height));
+        }
+    });
+
+    return rval;
+}
+
+const Pixel* MappedImage::tileData(int level, int tx, int ty) const
+{
+    const Level& lvl = share->levels.at(level);
+
+    if (tx < 0 || ty < 0 || std::uint32_t(tx) >= lvl.tilesX || std::uint32_t(ty) >= lvl.tilesY)
+    {
+        std::stringstream ss;
+        ss << "Tile (" << tx << "," << ty << ") of level " << level << " is out of range.";
+        throw MappedImageException(share->filename, ss.str());
+    }
+
+    const std::size_t index = std::size_t(ty)*lvl.tilesX + tx;
+    return reinterpret_cast<const Pixel*>(share->data + lvl.offset + index*share->tileBytes);
+}
+
+} // namespace Inugami
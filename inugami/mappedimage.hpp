@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_MAPPEDIMAGE_H
+#define INUGAMI_MAPPEDIMAGE_H
+
+#include "inugami.hpp"
+
+#include "image.hpp"
+
+#include <memory>
+#include <string>
+
+namespace Inugami {
+
+/*! @brief Memory-mapped tiled image file.
+ *
+ *  Maps an image file written by save() into memory. The file holds a
+ *  header, a directory of mip levels, and uncompressed RGBA8 tiles aligned
+ *  to 64 bytes, so tiles are used directly from the mapping with no
+ *  decoding. Only the tiles that are touched are read from disk, which
+ *  keeps very large images cheap to open.
+ *
+ *  Tiles are square, stored bottom row first like Image, and ordered by row
+ *  from the bottom-left corner. Tiles on the right and top edges are padded.
+ *
+ *  Copies of a MappedImage share the same mapping.
+ */
+class MappedImage
+{
+public:
+    /*! @brief Writes an image file.
+     *
+     *  @param filename Name of file to write.
+     *  @param img Image to write.
+     *  @param mipmaps Also writes each halved level down to 1x1.
+     *  @param tileSize Width and height of tiles, a multiple of 4.
+     */
+    static void save(const std::string& filename, ConstImageView img, bool mipmaps=true, int tileSize=64);
+
+    /*! @brief Default constructor.
+     */
+    MappedImage() = default;
+
+    /*! @brief Primary constructor.
+     *
+     *  Maps the given file, and checks its header and directory.
+     *
+     *  @param filename Name of file to map.
+     */
+    explicit MappedImage(const std::string& filename);
+
+    /*! @brief Gets the number of mip levels.
+     */
+    int getLevels() const;
+
+    /*! @brief Gets the width of a level, in pixels.
+     */
+    int getWidth(int level=0) const;
+
+    /*! @brief Gets the height of a level, in pixels.
+     */
+    int getHeight(int level=0) const;
+
+    /*! @brief Gets the width and height of tiles, in pixels.
+     */
+    int getTileSize() const;
+
+    /*! @brief Gets the number of tile columns in a level.
+     */
+    int getTilesX(int level=0) const;
+
+    /*! @brief Gets the number of tile rows in a level.
+     */
+    int getTilesY(int level=0) const;
+
+    /*! @brief Gets a tile.
+     *
+     *  @note The view is only valid while the MappedImage, or a copy of it,
+     *  exists.
+     *
+     *  @param level Mip level.
+     *  @param tx Tile column.
+     *  @param ty Tile row.
+     *
+     *  @return View of the tile's pixels, clipped to the edges of the level.
+     */
+    ConstImageView getTile(int level, int tx, int ty) const;
+
+    /*! @brief Hints that a tile will be used soon.
+     *
+     *  Asks the operating system to start reading the tile from disk.
+     *
+     *  @param level Mip level.
+     *  @param tx Tile column.
+     *  @param ty Tile row.
+     */
+    void prefetch(int level, int tx, int ty) const;
+
+    /*! @brief Copies a level into an Image.
+     *
+     *  @param level Mip level.
+     *
+     *  @return Image containing the level.
+     */
+    Image getImage(int level=0) const;
+
+private:
+    class Shared;
+
+    const Pixel* tileData(int level, int tx, int ty) const;
+
+    std::shared_ptr<Shared> share;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_MAPPEDIMAGE_H
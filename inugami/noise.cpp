@@ -0,0 +1,477 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "noise.hpp"
+
+#include "math.hpp"
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Inugami {
+
+namespace {
+
+#ifdef INU_MM
+using SIMD::Vec;
+using SIMD::VecF;
+#endif
+
+// Number of interleaved white noise generators per row.
+const int LANES = 8;
+
+std::uint64_t splitmix(std::uint64_t& s)
+{
+    std::uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+std::uint32_t mix32(std::uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+std::uint32_t rotl(std::uint32_t x, int k)
+{
+    return (x << k) | (x >> (32-k));
+}
+
+/*  Fills a row with eight interleaved xoshiro128+ generators, one 32-bit
+ *  output per pixel. Pixel x comes from generator x%8, so the vector and
+ *  scalar paths produce the same row.
+ */
+void whiteRow(Pixel* row, int w, std::uint64_t key)
+{
+    std::uint32_t st[4][LANES];
+    for (int i=0; i<LANES; ++i)
+    {
+        std::uint64_t a = splitmix(key);
+        std::uint64_t b = splitmix(key);
+        st[0][i] = a;
+        st[1][i] = a >> 32;
+        st[2][i] = b;
+        st[3][i] = (b >> 32) | 1;
+    }
+
+    int x = 0;
+
+#ifdef INU_MM
+    const int V = sizeof(Vec)/sizeof(std::uint32_t);
+    const int N = LANES/V;
+
+    Vec s[4][N];
+    for (int k=0; k<4; ++k)
+    {
+        for (int j=0; j<N; ++j)
+        {
+            s[k][j] = INU_SI(loadu)(reinterpret_cast<const Vec*>(&st[k][j*V]));
+        }
+    }
+
+    for (; x+LANES<=w; x+=LANES)
+    {
+        for (int j=0; j<N; ++j)
+        {
+            INU_SI(storeu)(reinterpret_cast<Vec*>(row+x+j*V), INU_MM(add_epi32)(s[0][j], s[3][j]));
+            const Vec t = INU_MM(slli_epi32)(s[1][j], 9);
+            s[2][j] = INU_SI(xor)(s[2][j], s[0][j]);
+            s[3][j] = INU_SI(xor)(s[3][j], s[1][j]);
+            s[1][j] = INU_SI(xor)(s[1][j], s[2][j]);
+            s[0][j] = INU_SI(xor)(s[0][j], s[3][j]);
+            s[2][j] = INU_SI(xor)(s[2][j], t);
+            s[3][j] = INU_SI(or)(INU_MM(slli_epi32)(s[3][j], 11), INU_MM(srli_epi32)(s[3][j], 21));
+        }
+    }
+
+    for (int k=0; k<4; ++k)
+    {
+        for (int j=0; j<N; ++j)
+        {
+            INU_SI(storeu)(reinterpret_cast<Vec*>(&st[k][j*V]), s[k][j]);
+        }
+    }
+#endif
+
+    for (; x<w; x+=LANES)
+    {
+        for (int i=0; i<LANES; ++i)
+        {
+            const std::uint32_t r = st[0][i] + st[3][i];
+            if (x+i < w) row[x+i] = Pixel(r, r >> 8, r >> 16, r >> 24);
+            const std::uint32_t t = st[1][i] << 9;
+            st[2][i] ^= st[0][i];
+            st[3][i] ^= st[1][i];
+            st[1][i] ^= st[2][i];
+            st[0][i] ^= st[3][i];
+            st[2][i] ^= t;
+            st[3][i] = rotl(st[3][i], 11);
+        }
+    }
+}
+
+// Maps pixel coordinates along one axis to lattice cells.
+struct Axis
+{
+    float scale;
+    std::uint32_t wrap; //!< Number of cells, or 0 for no wrapping.
+
+    Axis(int size, float period, bool tileable)
+        : scale(1.f/period)
+        , wrap(0)
+    {
+        if (tileable)
+        {
+            wrap = std::max(1L, std::lround(size/period));
+            scale = float(wrap)/size;
+        }
+    }
+
+    void locate(int i, std::uint32_t& c0, std::uint32_t& c1, float& t) const
+    {
+        const float f = i*scale;
+        const float fl = std::floor(f);
+        t = f-fl;
+        c0 = std::uint32_t(fl);
+        c1 = c0+1;
+        if (wrap)
+        {
+            c0 %= wrap;
+            c1 %= wrap;
+        }
+    }
+};
+
+float fade(float t)
+{
+    return t*t*t*(t*(t*6.f-15.f)+10.f);
+}
+
+struct Octave
+{
+    // A span of pixels within one lattice column.
+    struct Run
+    {
+        int x0;
+        int x1;
+        std::uint32_t c0;
+        std::uint32_t c1;
+    };
+
+    Octave(int w, int h, float period, bool tileable, float amp)
+        : ax(w, period, tileable)
+        , ay(h, period, tileable)
+        , amp(amp)
+        , tx(w)
+        , sx(w)
+        , runs()
+    {
+        for (int x=0; x<w; ++x)
+        {
+            std::uint32_t c0, c1;
+            ax.locate(x, c0, c1, tx[x]);
+            sx[x] = fade(tx[x]);
+            if (runs.empty() || runs.back().c0 != c0)
+            {
+                runs.push_back(Run{x, x, c0, c1});
+            }
+            runs.back().x1 = x+1;
+        }
+    }
+
+    Axis ax;
+    Axis ay;
+    float amp;
+    std::vector<float> tx;
+    std::vector<float> sx;
+    std::vector<Run> runs;
+};
+
+/*  Adds amp*lerp(p0*tx+q0, p1*tx+q1, sx) to a span of a row. Perlin noise
+ *  within one lattice cell is exactly this once the row is fixed, and value
+ *  noise is the special case p0 = p1 = 0.
+ */
+void accumulate(float* acc, const float* tx, const float* sx, int n, float p0, float q0, float p1, float q1)
+{
+    int i = 0;
+
+#ifdef INU_MM
+    const int V = sizeof(VecF)/sizeof(float);
+    const VecF vp0 = INU_MM(set1_ps)(p0);
+    const VecF vq0 = INU_MM(set1_ps)(q0);
+    const VecF vp1 = INU_MM(set1_ps)(p1);
+    const VecF vq1 = INU_MM(set1_ps)(q1);
+    for (; i+V<=n; i+=V)
+    {
+        const VecF t = INU_MM(loadu_ps)(tx+i);
+        const VecF m0 = INU_MM(add_ps)(INU_MM(mul_ps)(vp0, t), vq0);
+        const VecF m1 = INU_MM(add_ps)(INU_MM(mul_ps)(vp1, t), vq1);
+        const VecF m = INU_MM(add_ps)(m0, INU_MM(mul_ps)(INU_MM(loadu_ps)(sx+i), INU_MM(sub_ps)(m1, m0)));
+        INU_MM(storeu_ps)(acc+i, INU_MM(add_ps)(INU_MM(loadu_ps)(acc+i), m));
+    }
+#endif
+
+    for (; i<n; ++i)
+    {
+        const float m0 = p0*tx[i]+q0;
+        const float m1 = p1*tx[i]+q1;
+        acc[i] += m0 + sx[i]*(m1-m0);
+    }
+}
+
+const float GRADIENTS[8][2] = {
+      { 1.f,         0.f        }
+    , { 0.70710678f, 0.70710678f}
+    , { 0.f,         1.f        }
+    , {-0.70710678f, 0.70710678f}
+    , {-1.f,         0.f        }
+    , {-0.70710678f,-0.70710678f}
+    , { 0.f,        -1.f        }
+    , { 0.70710678f,-0.70710678f}
+};
+
+SubPixel toSubPixel(float v)
+{
+    return clamp(v*127.5f+128.f, 0.f, 255.f);
+}
+
+} // namespace
+
+Noise::Noise(Type type, unsigned seed)
+    : type(type)
+    , seed(seed)
+    , period(32.f)
+    , octaves(1)
+    , lacunarity(2.f)
+    , gain(0.5f)
+    , tileable(false)
+    , gray(false)
+{}
+
+Noise& Noise::setSeed(unsigned s)
+{
+    seed = s;
+    return *this;
+}
+
+Noise& Noise::setPeriod(float p)
+{
+    period = p;
+    return *this;
+}
+
+Noise& Noise::setOctaves(int n)
+{
+    octaves = n;
+    return *this;
+}
+
+Noise& Noise::setLacunarity(float l)
+{
+    lacunarity = l;
+    return *this;
+}
+
+Noise& Noise::setGain(float g)
+{
+    gain = g;
+    return *this;
+}
+
+Noise& Noise::setTileable(bool t)
+{
+    tileable = t;
+    return *this;
+}
+
+Noise& Noise::setGray(bool g)
+{
+    gray = g;
+    return *this;
+}
+
+void Noise::fill(ImageView dst) const
+{
+    if (dst.width == 0 || dst.height == 0) return;
+
+    if (type == Type::WHITE) fillWhite(dst);
+    else fillLattice(dst);
+}
+
+Image Noise::generate(int w, int h) const
+{
+    Image rval(w, h);
+    fill(rval);
+    return rval;
+}
+
+void Noise::fillWhite(ImageView dst) const
+{
+    const int w = dst.width;
+
+    ThreadPool::global().parallelBands(dst.height, w*sizeof(Pixel), [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y)
+        {
+            Pixel* row = dst[y];
+            whiteRow(row, w, (std::uint64_t(seed) << 32) | std::uint32_t(y));
+
+            if (gray)
+            {
+                for (int x=0; x<w; ++x)
+                {
+                    row[x] = Pixel(row[x][0], row[x][0], row[x][0], 255);
+                }
+            }
+        }
+    });
+}
+
+void Noise::fillLattice(ImageView dst) const
+{
+    const int w = dst.width;
+    const int h = dst.height;
+    const int channels = (gray? 1 : 4);
+
+    std::vector<Octave> octs;
+    {
+        float p = std::max(period, 1.f);
+        float a = 1.f;
+        float total = 0.f;
+        for (int o=0; o<octaves && (o == 0 || p >= 1.f); ++o)
+        {
+            octs.emplace_back(w, h, p, tileable, a);
+            total += a;
+            p /= lacunarity;
+            a *= gain;
+        }
+
+        // Perlin noise with unit gradients stays within sqrt(1/2).
+        const float norm = (type == Type::PERLIN? 1.41421356f : 1.f)/total;
+        for (Octave& oct : octs) oct.amp *= norm;
+    }
+
+    std::vector<std::uint32_t> keys(octs.size()*channels);
+    for (std::size_t i=0; i<keys.size(); ++i)
+    {
+        keys[i] = mix32(seed ^ mix32(i+1));
+    }
+
+    ThreadPool::global().parallelBands(h, w*sizeof(Pixel), [&](int y0, int y1)
+    {
+        std::vector<float> acc(w*channels);
+
+        for (int y=y0; y<y1; ++y)
+        {
+            std::fill(acc.begin(), acc.end(), 0.f);
+
+            for (int c=0; c<channels; ++c)
+            {
+                for (std::size_t o=0; o<octs.size(); ++o)
+                {
+                    const Octave& oct = octs[o];
+                    const std::uint32_t key = keys[o*channels+c];
+
+                    std::uint32_t r0, r1;
+                    float ty;
+                    oct.ay.locate(y, r0, r1, ty);
+                    const float sy = fade(ty);
+                    const std::uint32_t k0 = mix32(r0 ^ key);
+                    const std::uint32_t k1 = mix32(r1 ^ key);
+
+                    for (const Octave::Run& run : oct.runs)
+                    {
+                        const std::uint32_t h00 = mix32(run.c0 + k0);
+                        const std::uint32_t h01 = mix32(run.c0 + k1);
+                        const std::uint32_t h10 = mix32(run.c1 + k0);
+                        const std::uint32_t h11 = mix32(run.c1 + k1);
+
+                        float p0 = 0.f, q0, p1 = 0.f, q1;
+
+                        if (type == Type::PERLIN)
+                        {
+                            const float* g00 = GRADIENTS[h00&7];
+                            const float* g01 = GRADIENTS[h01&7];
+                            const float* g10 = GRADIENTS[h10&7];
+                            const float* g11 = GRADIENTS[h11&7];
+                            p0 = lerp(g00[0], g01[0], sy);
+                            p1 = lerp(g10[0], g11[0], sy);
+                            q0 = lerp(g00[1]*ty, g01[1]*(ty-1.f), sy);
+                            q1 = lerp(g10[1]*ty-g10[0], g11[1]*(ty-1.f)-g11[0], sy);
+                        }
+                        else
+                        {
+                            auto value = [](std::uint32_t h)
+                            {
+                                return float(h >> 8)*(2.f/16777215.f)-1.f;
+                            };
+                            q0 = lerp(value(h00), value(h01), sy);
+                            q1 = lerp(value(h10), value(h11), sy);
+                        }
+
+                        const float a = oct.amp;
+                        accumulate(
+                              &acc[c*w+run.x0], &oct.tx[run.x0], &oct.sx[run.x0], run.x1-run.x0
+                            , p0*a, q0*a, p1*a, q1*a
+                        );
+                    }
+                }
+            }
+
+            Pixel* row = dst[y];
+            for (int x=0; x<w; ++x)
+            {
+                if (gray)
+                {
+                    const SubPixel v = toSubPixel(acc[x]);
+                    row[x] = Pixel(v, v, v, 255);
+                }
+                else
+                {
+                    row[x] = Pixel(
+                          toSubPixel(acc[x])
+                        , toSubPixel(acc[w+x])
+                        , toSubPixel(acc[w*2+x])
+                        , toSubPixel(acc[w*3+x])
+                    );
+                }
+            }
+        }
+    });
+}
+
+} // namespace Inugami
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_NOISE_H
+#define INUGAMI_NOISE_H
+
+#include "image.hpp"
+
+namespace Inugami {
+
+/*! @brief Procedural noise generator.
+ *
+ *  Fills images with white, value, or Perlin noise. Coherent noise is summed
+ *  over several octaves (fractal Brownian motion), each with a smaller period
+ *  and amplitude than the last.
+ *
+ *  Rows are generated in parallel, but the result only depends on the
+ *  settings and the size of the destination, not on the number of threads.
+ */
+class Noise
+{
+public:
+    enum class Type
+    {
+          WHITE  //!< Independent random values.
+        , VALUE  //!< Smoothly interpolated random values.
+        , PERLIN //!< Smoothly interpolated random gradients.
+    };
+
+    /*! @brief Primary constructor.
+     *
+     *  @param type Type of noise.
+     *  @param seed Random seed.
+     */
+    explicit Noise(Type type=Type::PERLIN, unsigned seed=0);
+
+    /*! @brief Sets the random seed.
+     *
+     *  @param s Seed.
+     *
+     *  @return Self.
+     */
+    Noise& setSeed(unsigned s);
+
+    /*! @brief Sets the size of the features of the first octave.
+     *
+     *  @param p Period, in pixels.
+     *
+     *  @return Self.
+     */
+    Noise& setPeriod(float p);
+
+    /*! @brief Sets the number of octaves.
+     *
+     *  Octaves with a period below one pixel are skipped.
+     *
+     *  @param n Number of octaves.
+     *
+     *  @return Self.
+     */
+    Noise& setOctaves(int n);
+
+    /*! @brief Sets the frequency ratio between octaves.
+     *
+     *  @param l Lacunarity, usually 2.
+     *
+     *  @return Self.
+     */
+    Noise& setLacunarity(float l);
+
+    /*! @brief Sets the amplitude ratio between octaves.
+     *
+     *  @param g Gain, usually 0.5.
+     *
+     *  @return Self.
+     */
+    Noise& setGain(float g);
+
+    /*! @brief Makes the noise wrap around the edges.
+     *
+     *  Periods are adjusted so that a whole number of features fits the
+     *  destination.
+     *
+     *  @param t True to tile.
+     *
+     *  @return Self.
+     */
+    Noise& setTileable(bool t);
+
+    /*! @brief Generates one opaque gray channel instead of four.
+     *
+     *  @param g True for grayscale.
+     *
+     *  @return Self.
+     */
+    Noise& setGray(bool g);
+
+    /*! @brief Fills a view with noise.
+     *
+     *  @param dst Destination view.
+     */
+    void fill(ImageView dst) const;
+
+    /*! @brief Creates an Image filled with noise.
+     *
+     *  @param w Width.
+     *  @param h Height.
+     *
+     *  @return Noise image.
+     */
+    Image generate(int w, int h) const;
+
+private:
+    void fillWhite(ImageView dst) const;
+    void fillLattice(ImageView dst) const;
+
+    Type type;
+    unsigned seed;
+    float period;
+    int octaves;
+    float lacunarity;
+    float gain;
+    bool tileable;
+    bool gray;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_NOISE_H
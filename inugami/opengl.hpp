@@ -71,6 +71,7 @@ struct GLType<int>
             , GL_SAMPLER_CUBE
             , GL_SAMPLER_1D_SHADOW
             , GL_SAMPLER_2D_SHADOW
+            , GL_SAMPLER_2D_ARRAY
         };
         for (auto&& i : uniformValues) if (t==i) return true;
         return false;
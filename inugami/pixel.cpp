@@ -29,6 +29,8 @@
 
 #include "math.hpp"
 
+#include <algorithm>
+
 namespace Inugami {
 
 Pixel::Pixel(int h)
@@ -93,7 +95,7 @@ Pixel& Pixel::operator+=(const Pixel& a)
 {
     auto op = [&](int i)
     {
-        data[i] = std::max(data[i]+a[i], 255);
+        data[i] = std::min(data[i]+a[i], 255);
     };
     for (int i=0; i<4; ++i) op(i);
     return *this;
@@ -103,7 +105,7 @@ Pixel& Pixel::operator-=(const Pixel& a)
 {
     auto op = [&](int i)
     {
-        data[i] = std::min(data[i]-a[i], 0);
+        data[i] = std::max(data[i]-a[i], 0);
     };
     for (int i=0; i<4; ++i) op(i);
     return *this;
@@ -134,7 +136,7 @@ Pixel& Pixel::operator*=(float f)
 {
     auto op = [&](int i)
     {
-        data[i] = clamp(int(data[i]*f), 0, 255);
+        data[i] = int(clamp(data[i]*f, 0.f, 255.f));
     };
     for (int i=0; i<4; ++i) op(i);
     return *this;
@@ -151,52 +153,56 @@ Pixel operator-(const Pixel& a)
 
 Pixel operator+(const Pixel& a, const Pixel& b)
 {
-    auto op = [&](int i)
-    {
-        return a[i]+b[i];
-    };
-    return Pixel(op(0), op(1), op(2), op(3));
+    Pixel rval = a;
+    return rval += b;
 }
 
 Pixel operator-(const Pixel& a, const Pixel& b)
 {
-    auto op = [&](int i)
-    {
-        return a[i]-b[i];
-    };
-    return Pixel(op(0), op(1), op(2), op(3));
+    Pixel rval = a;
+    return rval -= b;
 }
 
 Pixel operator*(const Pixel& a, const Pixel& b)
 {
-    auto op = [&](int i)
-    {
-        return (a[i]*b[i])/255;
-    };
-    return Pixel(op(0), op(1), op(2), op(3));
+    Pixel rval = a;
+    return rval *= b;
 }
 
 Pixel operator/(const Pixel& a, const Pixel& b)
 {
-    auto op = [&](int i)
-    {
-        return (a[i]*255)/b[i];
-    };
-    return Pixel(op(0), op(1), op(2), op(3));
+    Pixel rval = a;
+    return rval /= b;
 }
 
 Pixel operator*(const Pixel& a, float f)
+{
+    Pixel rval = a;
+    return rval *= f;
+}
+
+Pixel operator*(float f, const Pixel& a)
+{
+    return a*f;
+}
+
+Pixel blend(const Pixel& src, const Pixel& dst)
 {
     auto op = [&](int i)
     {
-        return a[i]*f;
+        return (src[i]*src.a() + dst[i]*(255-src.a()) + 127)/255;
     };
     return Pixel(op(0), op(1), op(2), op(3));
 }
 
-Pixel operator*(float f, const Pixel& a)
+Pixel mix(const Pixel& a, const Pixel& b, float t)
 {
-    return a*f;
+    int w = clamp(int(t*255.f+0.5f), 0, 255);
+    auto op = [&](int i)
+    {
+        return (a[i]*(255-w) + b[i]*w + 127)/255;
+    };
+    return Pixel(op(0), op(1), op(2), op(3));
 }
 
 } // namespace Inugami
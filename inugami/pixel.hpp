@@ -37,6 +37,9 @@ using SubPixel = unsigned char;
 /*! @brief An RGBA8 pixel.
  *
  *  An array of 8-bit SubPixel%s: red, green, blue, and alpha.
+ *
+ *  Arithmetic saturates at 0 and 255. Multiplication and division treat 255
+ *  as 1.0, and dividing by 0 gives 255.
  */
 class Pixel
 {
@@ -85,6 +88,29 @@ Pixel operator/(const Pixel& a, const Pixel& b);
 Pixel operator*(const Pixel& a, float f);
 Pixel operator*(float f, const Pixel& a);
 
+/*! @brief Alpha blends two pixels.
+ *
+ *  Composites @a src over @a dst, weighting every channel by the alpha of
+ *  @a src, as OpenGL does with @a GL_SRC_ALPHA and
+ *  @a GL_ONE_MINUS_SRC_ALPHA.
+ *
+ *  @param src Foreground pixel.
+ *  @param dst Background pixel.
+ *
+ *  @return Blended pixel.
+ */
+Pixel blend(const Pixel& src, const Pixel& dst);
+
+/*! @brief Linearly interpolates between two pixels.
+ *
+ *  @param a Pixel at @a t=0.
+ *  @param b Pixel at @a t=1.
+ *  @param t Weight of @a b, quantized to 1/255 steps.
+ *
+ *  @return Interpolated pixel.
+ */
+Pixel mix(const Pixel& a, const Pixel& b, float t);
+
 } // namespace Inugami
 
 #endif // INUGAMI_PIXEL_HPP
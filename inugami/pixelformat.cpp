@@ -0,0 +1,433 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "pixelformat.hpp"
+
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace Inugami {
+
+namespace {
+
+template <typename S, typename D>
+void checkSize(BasicImageView<S> src, BasicImageView<D> dst)
+{
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        throw ImageE_SizeMismatch(src.width, src.height, dst.width, dst.height);
+    }
+}
+
+// Runs a row kernel over every row of the views.
+template <typename S, typename D, typename Row>
+void apply(BasicImageView<const S> src, BasicImageView<D> dst, const Row& row)
+{
+    checkSize(src, dst);
+
+    const int w = dst.width;
+
+    ThreadPool::global().parallelBands(dst.height, w*sizeof(D), [&](int y0, int y1)
+    {
+        for (int y=y0; y<y1; ++y)
+        {
+            row(src[y], dst[y], w);
+        }
+    });
+}
+
+const SubPixel* bytes(const void* p)
+{
+    return static_cast<const SubPixel*>(p);
+}
+
+SubPixel* bytes(void* p)
+{
+    return static_cast<SubPixel*>(p);
+}
+
+std::uint32_t key(const Pixel& p)
+{
+    return std::uint32_t(p.r())
+        | std::uint32_t(p.g()) << 8
+        | std::uint32_t(p.b()) << 16
+        | std::uint32_t(p.a()) << 24
+    ;
+}
+
+SubPixel halfToByte(std::uint16_t h)
+{
+    if (h & 0x8000) return 0;
+    if (h >= 0x3c00) return 255;
+    return SubPixel(fromHalf(h)*255.f+0.5f);
+}
+
+#ifdef INU_MM
+
+using SIMD::Vec;
+
+constexpr int VecBytes = sizeof(Vec);
+
+Vec load(const void* p)
+{
+    return INU_SI(loadu)(static_cast<const Vec*>(p));
+}
+
+void store(void* p, Vec v)
+{
+    INU_SI(storeu)(static_cast<Vec*>(p), v);
+}
+
+// The pack and unpack intrinsics work within 128-bit lanes. These keep the
+// elements in order across the whole vector.
+
+Vec pack32(Vec a, Vec b)
+{
+    Vec v = INU_MM(packs_epi32)(a, b);
+#ifdef INU_SIMD_AVX2
+    v = _mm256_permute4x64_epi64(v, 0xD8);
+#endif
+    return v;
+}
+
+Vec pack16(Vec a, Vec b)
+{
+    Vec v = INU_MM(packus_epi16)(a, b);
+#ifdef INU_SIMD_AVX2
+    v = _mm256_permute4x64_epi64(v, 0xD8);
+#endif
+    return v;
+}
+
+Vec spread(Vec v)
+{
+#ifdef INU_SIMD_AVX2
+    v = _mm256_permute4x64_epi64(v, 0xD8);
+#endif
+    return v;
+}
+
+#endif // INU_MM
+
+#ifdef INU_SIMD_SSE2
+
+// Converts floats in [0,1] to halves, rounding to nearest even.
+__m128i floatToHalf(__m128 f)
+{
+    const __m128i b = _mm_castps_si128(f);
+    const __m128i odd = _mm_and_si128(_mm_srli_epi32(b, 13), _mm_set1_epi32(1));
+    __m128i h = _mm_sub_epi32(b, _mm_set1_epi32(0x38000000-0xfff));
+    h = _mm_srli_epi32(_mm_add_epi32(h, odd), 13);
+    return _mm_andnot_si128(_mm_cmpeq_epi32(b, _mm_setzero_si128()), h);
+}
+
+// Converts halves in the low 16 bits of each lane to bytes, as halfToByte.
+__m128i toByte(__m128i h)
+{
+    const __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+    const __m128i em = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+    __m128 f = _mm_mul_ps(_mm_castsi128_ps(em), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+    f = _mm_or_ps(f, _mm_castsi128_ps(sign));
+    f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f));
+    f = _mm_max_ps(_mm_min_ps(f, _mm_set1_ps(255.f)), _mm_setzero_ps());
+    return _mm_cvttps_epi32(f);
+}
+
+#endif // INU_SIMD_SSE2
+
+} // namespace
+
+std::uint16_t toHalf(float f)
+{
+    std::uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+
+    const std::uint16_t sign = (x >> 16) & 0x8000;
+    x &= 0x7fffffff;
+
+    if (x > 0x7f800000) return sign | 0x7e00;
+
+    if (x >= 0x38800000)
+    {
+        x = (x - 0x38000000 + 0xfff + ((x >> 13) & 1)) >> 13;
+        return sign | std::min<std::uint32_t>(x, 0x7c00);
+    }
+
+    if (x <= 0x33000000) return sign;
+
+    // Subnormal, in units of 2^-24.
+    const std::uint32_t mant = (x & 0x7fffff) | 0x800000;
+    const int shift = 126 - int(x >> 23);
+    const std::uint32_t half = 1u << (shift-1);
+    const std::uint32_t rem = mant & ((half << 1) - 1);
+    std::uint32_t h = mant >> shift;
+    if (rem > half || (rem == half && (h & 1))) ++h;
+    return sign | h;
+}
+
+float fromHalf(std::uint16_t h)
+{
+    const std::uint32_t sign = std::uint32_t(h & 0x8000) << 16;
+    std::uint32_t x = std::uint32_t(h & 0x7fff) << 13;
+    float f;
+
+    if (x >= (0x7c00u << 13))
+    {
+        x = sign | 0x7f800000 | (x & 0x7fffff);
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    // Scaling by 2^112 rebiases the exponent, and normalizes subnormals.
+    std::memcpy(&f, &x, sizeof(f));
+    f *= 5.192296858534828e33f;
+    return (sign)? -f : f;
+}
+
+IndexedImage IndexedImage::fromImage(ConstImageView in) //static
+{
+    IndexedImage rval(in.width, in.height, {});
+    std::unordered_map<std::uint32_t, SubPixel> found;
+
+    for (int y=0; y<in.height; ++y)
+    {
+        const Pixel* rs = in[y];
+        PixelR8* rd = rval.indices[y];
+        for (int x=0; x<in.width; ++x)
+        {
+            auto ins = found.insert({key(rs[x]), SubPixel(rval.palette.size())});
+            if (ins.second)
+            {
+                if (rval.palette.size() == 256) throw ImageE_Palette(256);
+                rval.palette.push_back(rs[x]);
+            }
+            rd[x].r = ins.first->second;
+        }
+    }
+
+    return rval;
+}
+
+IndexedImage::IndexedImage(int w, int h, std::vector<Pixel> pal)
+    : indices(w, h)
+    , palette(std::move(pal))
+{
+    if (palette.size() > 256) throw ImageE_Palette(256);
+}
+
+Image IndexedImage::toImage() const
+{
+    Image rval(indices.width, indices.height);
+    convert(indices, palette, rval);
+    return rval;
+}
+
+void extract(ConstImageView src, BasicImageView<PixelR8> dst, Pixel::Color channel)
+{
+    const int shift = int(channel)*8;
+
+    apply(src, dst, [shift](const Pixel* rs, PixelR8* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        SubPixel* d = bytes(rd);
+        int x = 0;
+#ifdef INU_MM
+        const Vec mask = INU_MM(set1_epi32)(0xff);
+        const __m128i count = _mm_cvtsi32_si128(shift);
+        for (; x+VecBytes<=w; x+=VecBytes)
+        {
+            Vec v[4];
+            for (int i=0; i<4; ++i)
+            {
+                v[i] = INU_SI(and)(INU_MM(srl_epi32)(load(s+(x+i*VecBytes/4)*4), count), mask);
+            }
+            store(d+x, pack16(pack32(v[0], v[1]), pack32(v[2], v[3])));
+        }
+#endif
+        for (; x<w; ++x) d[x] = s[x*4+shift/8];
+    });
+}
+
+void convert(ConstImageView src, BasicImageView<PixelRG8> dst)
+{
+    apply(src, dst, [](const Pixel* rs, PixelRG8* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        SubPixel* d = bytes(rd);
+        int x = 0;
+#ifdef INU_MM
+        for (; x+VecBytes/2<=w; x+=VecBytes/2)
+        {
+            Vec a = load(s+x*4);
+            Vec b = load(s+x*4+VecBytes);
+            a = INU_MM(srai_epi32)(INU_MM(slli_epi32)(a, 16), 16);
+            b = INU_MM(srai_epi32)(INU_MM(slli_epi32)(b, 16), 16);
+            store(d+x*2, pack32(a, b));
+        }
+#endif
+        for (; x<w; ++x)
+        {
+            d[x*2+0] = s[x*4+0];
+            d[x*2+1] = s[x*4+1];
+        }
+    });
+}
+
+void convert(ConstImageView src, BasicImageView<PixelRGBA16F> dst)
+{
+    apply(src, dst, [](const Pixel* rs, PixelRGBA16F* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        std::uint16_t* d = reinterpret_cast<std::uint16_t*>(rd);
+        int x = 0;
+#ifdef INU_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(255.f);
+        for (; x+4<=w; x+=4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s+x*4));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i h[4] = {
+                  _mm_unpacklo_epi16(lo, zero)
+                , _mm_unpackhi_epi16(lo, zero)
+                , _mm_unpacklo_epi16(hi, zero)
+                , _mm_unpackhi_epi16(hi, zero)
+            };
+            for (auto& i : h) i = floatToHalf(_mm_div_ps(_mm_cvtepi32_ps(i), scale));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d+x*4), _mm_packs_epi32(h[0], h[1]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d+x*4+8), _mm_packs_epi32(h[2], h[3]));
+        }
+#endif
+        for (x*=4; x<w*4; ++x) d[x] = toHalf(float(s[x])/255.f);
+    });
+}
+
+void convert(BasicImageView<const PixelR8> src, ImageView dst)
+{
+    apply(src, dst, [](const PixelR8* rs, Pixel* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        int x = 0;
+#ifdef INU_MM
+        const Vec alpha = INU_MM(set1_epi32)(int(0xff000000));
+        for (; x+VecBytes<=w; x+=VecBytes)
+        {
+            const Vec v = spread(load(s+x));
+            const Vec pairs[2] = {
+                  spread(INU_MM(unpacklo_epi8)(v, v))
+                , spread(INU_MM(unpackhi_epi8)(v, v))
+            };
+            for (int i=0; i<2; ++i)
+            {
+                Pixel* p = rd+x+i*VecBytes/2;
+                store(p, INU_SI(or)(INU_MM(unpacklo_epi16)(pairs[i], pairs[i]), alpha));
+                store(p+VecBytes/4, INU_SI(or)(INU_MM(unpackhi_epi16)(pairs[i], pairs[i]), alpha));
+            }
+        }
+#endif
+        for (; x<w; ++x) rd[x] = Pixel(s[x], s[x], s[x], 255);
+    });
+}
+
+void convert(BasicImageView<const PixelRG8> src, ImageView dst)
+{
+    apply(src, dst, [](const PixelRG8* rs, Pixel* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        int x = 0;
+#ifdef INU_MM
+        const Vec ba = INU_MM(set1_epi16)(short(0xff00));
+        for (; x+VecBytes/2<=w; x+=VecBytes/2)
+        {
+            const Vec v = spread(load(s+x*2));
+            store(rd+x, INU_MM(unpacklo_epi16)(v, ba));
+            store(rd+x+VecBytes/4, INU_MM(unpackhi_epi16)(v, ba));
+        }
+#endif
+        for (; x<w; ++x) rd[x] = Pixel(s[x*2], s[x*2+1], 0, 255);
+    });
+}
+
+void convert(BasicImageView<const PixelRGBA16F> src, ImageView dst)
+{
+    apply(src, dst, [](const PixelRGBA16F* rs, Pixel* rd, int w)
+    {
+        const std::uint16_t* s = reinterpret_cast<const std::uint16_t*>(rs);
+        SubPixel* d = bytes(rd);
+        int x = 0;
+#ifdef INU_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; x+4<=w; x+=4)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s+x*4));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s+x*4+8));
+            const __m128i lo = _mm_packs_epi32(
+                  toByte(_mm_unpacklo_epi16(a, zero))
+                , toByte(_mm_unpackhi_epi16(a, zero))
+            );
+            const __m128i hi = _mm_packs_epi32(
+                  toByte(_mm_unpacklo_epi16(b, zero))
+                , toByte(_mm_unpackhi_epi16(b, zero))
+            );
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d+x*4), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (x*=4; x<w*4; ++x) d[x] = halfToByte(s[x]);
+    });
+}
+
+void convert(BasicImageView<const PixelR8> src, const std::vector<Pixel>& palette, ImageView dst)
+{
+    if (palette.size() > 256) throw ImageE_Palette(256);
+
+    // Every index has an entry, so lookups need no bounds check.
+    std::vector<Pixel> table (256, Pixel(0, 0, 0, 0));
+    std::copy(palette.begin(), palette.end(), table.begin());
+
+    apply(src, dst, [&table](const PixelR8* rs, Pixel* rd, int w)
+    {
+        const SubPixel* s = bytes(rs);
+        int x = 0;
+#ifdef INU_SIMD_AVX2
+        const int* base = reinterpret_cast<const int*>(table.data());
+        for (; x+8<=w; x+=8)
+        {
+            const __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s+x)));
+            store(rd+x, _mm256_i32gather_epi32(base, idx, 4));
+        }
+#endif
+        for (; x<w; ++x) rd[x] = table[s[x]];
+    });
+}
+
+} // namespace Inugami
@@ -0,0 +1,308 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_PIXELFORMAT_H
+#define INUGAMI_PIXELFORMAT_H
+
+#include "image.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Inugami {
+
+class ImageE_Palette
+    : public Exception
+{
+    std::string err;
+public:
+    ImageE_Palette(int colors)
+        : err()
+    {
+        std::stringstream ss;
+        ss << "Inugami::Image Exception: Image has more than " << colors
+           << " colors."
+        ;
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+};
+
+/*! @brief An 8-bit single channel pixel.
+ */
+struct PixelR8
+{
+    SubPixel r;
+};
+
+/*! @brief An 8-bit two channel pixel.
+ */
+struct PixelRG8
+{
+    SubPixel r;
+    SubPixel g;
+};
+
+/*! @brief A 16-bit floating point RGBA pixel.
+ *
+ *  Each channel is an IEEE half-precision float, where 1.0 is full
+ *  intensity. Use toHalf() and fromHalf() to access the channels.
+ */
+struct PixelRGBA16F
+{
+    std::uint16_t r;
+    std::uint16_t g;
+    std::uint16_t b;
+    std::uint16_t a;
+};
+
+/*! @brief Converts a float to half precision.
+ *
+ *  Rounds to nearest even. Values too large for a half become infinity.
+ */
+std::uint16_t toHalf(float f);
+
+/*! @brief Converts a half precision float to a float.
+ */
+float fromHalf(std::uint16_t h);
+
+/*! @brief Container for pixel data in a format other than RGBA8.
+ *
+ *  A plain owning buffer of pixels, for data that does not need all four
+ *  8-bit channels of an Image. Rows are stored bottom-up without gaps, the
+ *  same as Image, and a Texture can be created from the common formats.
+ *
+ *  Unlike Image, copies do not share their pixels.
+ *
+ *  @tparam T Pixel type.
+ */
+template <typename T>
+class BasicImage
+{
+    template <typename A>
+    using Const = ConstAttr<A,BasicImage>;
+
+public:
+    /*! @brief A row of pixels.
+     */
+    using Row = T*;
+
+    /*! @brief Default contructor.
+     */
+    BasicImage()
+        : width(0)
+        , height(0)
+        , pixels()
+    {}
+
+    /*! @brief Solid color constructor.
+     *
+     *  @param w Width.
+     *  @param h Height.
+     *  @param color Pixel to fill the image with.
+     */
+    BasicImage(int w, int h, const T& color = T())
+        : width(w)
+        , height(h)
+        , pixels(std::size_t(w)*h, color)
+    {}
+
+    /*! @brief Access the row at the given location.
+     *
+     *  @param y Y coordinate.
+     *
+     *  @return Row of pixels.
+     */
+    T* operator[](int y) &
+    {
+        return pixels.data()+y*width;
+    }
+
+    /*! @brief Access the row at the given location.
+     *
+     *  @param y Y coordinate.
+     *
+     *  @return Row of pixels.
+     */
+    const T* operator[](int y) const&
+    {
+        return pixels.data()+y*width;
+    }
+
+    /*! @brief Creates a mutable view of the whole image.
+     */
+    BasicImageView<T> view() &
+    {
+        return BasicImageView<T>(pixels.data(), width, height, width);
+    }
+
+    /*! @brief Creates a read-only view of the whole image.
+     */
+    BasicImageView<const T> view() const&
+    {
+        return BasicImageView<const T>(pixels.data(), width, height, width);
+    }
+
+    /*! @brief Converts to a mutable view.
+     */
+    operator BasicImageView<T>() &
+    {
+        return view();
+    }
+
+    /*! @brief Converts to a read-only view.
+     */
+    operator BasicImageView<const T>() const&
+    {
+        return view();
+    }
+
+    /*! @brief Width of the image, in pixels.
+     */
+    Const<int> width;
+
+    /*! @brief Height of the image, in pixels.
+     */
+    Const<int> height;
+
+private:
+    std::vector<T> pixels;
+};
+
+using ImageR8 = BasicImage<PixelR8>;            //!< Single channel image.
+using ImageRG8 = BasicImage<PixelRG8>;          //!< Two channel image.
+using ImageRGBA16F = BasicImage<PixelRGBA16F>;  //!< Floating point image.
+
+/*! @brief An 8-bit image with a palette of up to 256 colors.
+ *
+ *  Each index selects a Pixel from the palette. Indexes outside of the
+ *  palette are transparent black.
+ */
+class IndexedImage
+{
+public:
+    /*! @brief Creates an IndexedImage from an RGBA8 view.
+     *
+     *  The palette is built from the colors of the view, in the order they
+     *  are found.
+     *
+     *  @param in View with at most 256 distinct colors.
+     *
+     *  @return IndexedImage with the same pixels as @a in.
+     */
+    static IndexedImage fromImage(ConstImageView in);
+
+    /*! @brief Default contructor.
+     */
+    IndexedImage() = default;
+
+    /*! @brief Canvas constructor.
+     *
+     *  Constructs the IndexedImage with every index set to 0.
+     *
+     *  @param w Width.
+     *  @param h Height.
+     *  @param pal Palette.
+     */
+    IndexedImage(int w, int h, std::vector<Pixel> pal);
+
+    /*! @brief Expands the indexes into an RGBA8 Image.
+     */
+    Image toImage() const;
+
+    ImageR8 indices;            //!< Palette index of each pixel.
+    std::vector<Pixel> palette; //!< Colors, at most 256.
+};
+
+/*  Conversions between formats.
+ *
+ *  Sources and destination must be the same size. Channels that the source
+ *  does not have are filled with 0, except alpha, which is filled with 255.
+ */
+
+/*! @brief Copies one channel of an RGBA8 view.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ *  @param channel Channel to copy.
+ */
+void extract(ConstImageView src, BasicImageView<PixelR8> dst, Pixel::Color channel = Pixel::ALPHA);
+
+/*! @brief Copies the red and green channels of an RGBA8 view.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ */
+void convert(ConstImageView src, BasicImageView<PixelRG8> dst);
+
+/*! @brief Converts an RGBA8 view to floating point.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ */
+void convert(ConstImageView src, BasicImageView<PixelRGBA16F> dst);
+
+/*! @brief Expands a single channel view to opaque gray.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ */
+void convert(BasicImageView<const PixelR8> src, ImageView dst);
+
+/*! @brief Expands a two channel view to RGBA8.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ */
+void convert(BasicImageView<const PixelRG8> src, ImageView dst);
+
+/*! @brief Converts a floating point view to RGBA8.
+ *
+ *  Channels are clamped to [0,1] and rounded.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ */
+void convert(BasicImageView<const PixelRGBA16F> src, ImageView dst);
+
+/*! @brief Looks up palette indexes.
+ *
+ *  @param src Index view.
+ *  @param palette Colors, at most 256.
+ *  @param dst Destination view.
+ */
+void convert(BasicImageView<const PixelR8> src, const std::vector<Pixel>& palette, ImageView dst);
+
+} // namespace Inugami
+
+#endif // INUGAMI_PIXELFORMAT_H
@@ -0,0 +1,328 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "resample.hpp"
+
+#include "math.hpp"
+#include "threadpool.hpp"
+#include "detail/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Inugami {
+
+namespace {
+
+#ifdef INU_MM
+using SIMD::VecF;
+#endif
+
+float support(ResampleFilter filter)
+{
+    switch (filter)
+    {
+        case ResampleFilter::POINT:    return 0.5f;
+        case ResampleFilter::BILINEAR: return 1.f;
+        case ResampleFilter::BICUBIC:  return 2.f;
+        case ResampleFilter::LANCZOS3: return 3.f;
+    }
+    return 1.f;
+}
+
+float sinc(float x)
+{
+    if (x == 0.f) return 1.f;
+    x *= float(PI);
+    return std::sin(x)/x;
+}
+
+float weigh(ResampleFilter filter, float x)
+{
+    x = std::abs(x);
+
+    switch (filter)
+    {
+        case ResampleFilter::POINT:
+            return (x < 0.5f? 1.f : 0.f);
+
+        case ResampleFilter::BILINEAR:
+            return std::max(1.f-x, 0.f);
+
+        case ResampleFilter::BICUBIC:
+            if (x < 1.f) return (1.5f*x-2.5f)*x*x+1.f;
+            if (x < 2.f) return ((-0.5f*x+2.5f)*x-4.f)*x+2.f;
+            return 0.f;
+
+        case ResampleFilter::LANCZOS3:
+            if (x < 3.f) return sinc(x)*sinc(x/3.f);
+            return 0.f;
+    }
+
+    return 0.f;
+}
+
+/*  Source pixels and weights for each destination pixel along one axis.
+ *
+ *  Every destination pixel has the same number of taps. Taps past the edges
+ *  are clamped to the border pixel.
+ */
+struct Taps
+{
+    Taps(int srcSize, int dstSize, ResampleFilter filter)
+        : n(1)
+        , index()
+        , weight()
+    {
+        const float scale = float(srcSize)/dstSize;
+
+        if (filter == ResampleFilter::POINT)
+        {
+            for (int i=0; i<dstSize; ++i)
+            {
+                index.push_back(std::min(int((i+0.5f)*scale), srcSize-1));
+                weight.push_back(1.f);
+            }
+            return;
+        }
+
+        const float stretch = std::max(scale, 1.f);
+        const float radius = support(filter)*stretch;
+        n = std::max(int(std::ceil(radius*2.f)), 1);
+
+        for (int i=0; i<dstSize; ++i)
+        {
+            const float center = (i+0.5f)*scale-0.5f;
+            const int first = int(std::floor(center-radius))+1;
+            const std::size_t base = weight.size();
+
+            float sum = 0.f;
+            for (int t=0; t<n; ++t)
+            {
+                const float w = weigh(filter, (first+t-center)/stretch);
+                index.push_back(clamp(first+t, 0, srcSize-1));
+                weight.push_back(w);
+                sum += w;
+            }
+
+            if (sum != 0.f)
+            {
+                for (int t=0; t<n; ++t) weight[base+t] /= sum;
+            }
+        }
+    }
+
+    int n;
+    std::vector<int> index;
+    std::vector<float> weight;
+};
+
+// Converts a row to floats with premultiplied alpha.
+void premultiply(const SubPixel* in, int w, float* out)
+{
+    for (int x=0; x<w*4; x+=4)
+    {
+        const float a = in[x+3]*(1.f/255.f);
+        out[x+0] = in[x+0]*a;
+        out[x+1] = in[x+1]*a;
+        out[x+2] = in[x+2]*a;
+        out[x+3] = in[x+3];
+    }
+}
+
+// Converts a premultiplied row back to bytes.
+void unpremultiply(const float* in, int w, SubPixel* out)
+{
+    auto toSubPixel = [](float v)
+    {
+        return SubPixel(clamp(v, 0.f, 255.f)+0.5f);
+    };
+
+    for (int x=0; x<w*4; x+=4)
+    {
+        const float a = in[x+3];
+        const float k = (a > 0.f? 255.f/a : 0.f);
+        out[x+0] = toSubPixel(in[x+0]*k);
+        out[x+1] = toSubPixel(in[x+1]*k);
+        out[x+2] = toSubPixel(in[x+2]*k);
+        out[x+3] = toSubPixel(a);
+    }
+}
+
+// Filters a premultiplied row horizontally, one pixel per SSE vector.
+// Destination pixels start at x0, and source pixels at sx.
+void filterRow(const float* in, int sx, const Taps& taps, int x0, int w, float* out)
+{
+    const int* index = &taps.index[x0*taps.n];
+    const float* weight = &taps.weight[x0*taps.n];
+
+    for (int x=0; x<w; ++x, index+=taps.n, weight+=taps.n)
+    {
+#ifdef INU_SIMD_SSE2
+        __m128 acc = _mm_setzero_ps();
+        for (int t=0; t<taps.n; ++t)
+        {
+            const __m128 p = _mm_loadu_ps(in+(index[t]-sx)*4);
+            acc = _mm_add_ps(acc, _mm_mul_ps(p, _mm_set1_ps(weight[t])));
+        }
+        _mm_storeu_ps(out+x*4, acc);
+#else
+        float acc[4] = {0.f, 0.f, 0.f, 0.f};
+        for (int t=0; t<taps.n; ++t)
+        {
+            for (int k=0; k<4; ++k) acc[k] += in[(index[t]-sx)*4+k]*weight[t];
+        }
+        std::copy(acc, acc+4, out+x*4);
+#endif
+    }
+}
+
+// Adds a weighted row of floats to an accumulator.
+void accumulate(float* acc, const float* in, int n, float w)
+{
+    int i = 0;
+
+#ifdef INU_MM
+    const int V = sizeof(VecF)/sizeof(float);
+    const VecF vw = INU_MM(set1_ps)(w);
+    for (; i+V<=n; i+=V)
+    {
+        const VecF p = INU_MM(mul_ps)(INU_MM(loadu_ps)(in+i), vw);
+        INU_MM(storeu_ps)(acc+i, INU_MM(add_ps)(INU_MM(loadu_ps)(acc+i), p));
+    }
+#endif
+
+    for (; i<n; ++i) acc[i] += in[i]*w;
+}
+
+} // namespace
+
+class Resampler::Axis
+    : public Taps
+{
+public:
+    using Taps::Taps;
+};
+
+Resampler::Resampler(int srcWidth, int srcHeight, int dstWidth, int dstHeight, ResampleFilter filter)
+    : filter(filter)
+    , tx(std::make_shared<Axis>(srcWidth,  dstWidth,  filter))
+    , ty(std::make_shared<Axis>(srcHeight, dstHeight, filter))
+{}
+
+void Resampler::getSource(int x, int y, int w, int h, int& sx, int& sy, int& sw, int& sh) const
+{
+    auto range = [](const Taps& taps, int first, int count, int& lo, int& size)
+    {
+        if (count == 0)
+        {
+            lo = size = 0;
+            return;
+        }
+        const auto b = taps.index.begin()+first*taps.n;
+        const auto e = taps.index.begin()+(first+count)*taps.n;
+        const auto mm = std::minmax_element(b, e);
+        lo = *mm.first;
+        size = *mm.second-lo+1;
+    };
+
+    range(*tx, x, w, sx, sw);
+    range(*ty, y, h, sy, sh);
+}
+
+void Resampler::apply(ConstImageView src, int sx, int sy, ImageView dst, int x, int y) const
+{
+    if (src.width == 0 || src.height == 0 || dst.width == 0 || dst.height == 0) return;
+
+    const int w = dst.width;
+
+    if (filter == ResampleFilter::POINT)
+    {
+        for (int r=0; r<dst.height; ++r)
+        {
+            const Pixel* in = src[ty->index[y+r]-sy];
+            Pixel* out = dst[r];
+            for (int c=0; c<w; ++c) out[c] = in[tx->index[x+c]-sx];
+        }
+        return;
+    }
+
+    const int n = w*4;
+    const int taps = ty->n;
+
+    const auto first = ty->index.begin()+y*taps;
+    const auto last  = ty->index.begin()+(y+dst.height)*taps;
+    const int lo = *std::min_element(first, last);
+    const int hi = *std::max_element(first, last);
+
+    std::vector<float> line (src.width*4);
+    std::vector<float> rows ((hi-lo+1)*n);
+    std::vector<float> acc  (n);
+
+    // Each source row is filtered horizontally once, then the rows are
+    // combined vertically.
+    for (int r=lo; r<=hi; ++r)
+    {
+        premultiply(&src[r-sy][0][0], src.width, &line[0]);
+        filterRow(&line[0], sx, *tx, x, w, &rows[(r-lo)*n]);
+    }
+
+    for (int r=0; r<dst.height; ++r)
+    {
+        std::fill(acc.begin(), acc.end(), 0.f);
+        for (int t=0; t<taps; ++t)
+        {
+            const float wt = ty->weight[(y+r)*taps+t];
+            if (wt != 0.f) accumulate(&acc[0], &rows[(ty->index[(y+r)*taps+t]-lo)*n], n, wt);
+        }
+        unpremultiply(&acc[0], w, &dst[r][0][0]);
+    }
+}
+
+void resample(ConstImageView src, ImageView dst, ResampleFilter filter)
+{
+    if (src.width == 0 || src.height == 0 || dst.width == 0 || dst.height == 0) return;
+
+    const Resampler r (src.width, src.height, dst.width, dst.height, filter);
+
+    // Bands repeat a few source rows at their edges rather than sharing
+    // them between threads.
+    ThreadPool::global().parallelBands(dst.height, dst.width*sizeof(Pixel), [&](int y0, int y1)
+    {
+        r.apply(src, 0, 0, dst.sub(0, y0, dst.width, y1-y0), 0, y0);
+    });
+}
+
+Image resample(ConstImageView img, int w, int h, ResampleFilter filter)
+{
+    Image rval(w, h);
+    resample(img, rval, filter);
+    return rval;
+}
+
+} // namespace Inugami
@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_RESAMPLE_H
+#define INUGAMI_RESAMPLE_H
+
+#include "image.hpp"
+
+#include <memory>
+
+namespace Inugami {
+
+/*! @brief Reconstruction filter used when resampling.
+ */
+enum class ResampleFilter
+{
+      POINT    //!< Nearest pixel.
+    , BILINEAR //!< Triangle filter, radius 1.
+    , BICUBIC  //!< Catmull-Rom spline, radius 2.
+    , LANCZOS3 //!< Windowed sinc, radius 3.
+};
+
+/*! @brief Resamples an image one region at a time.
+ *
+ *  Gives the same pixels as resample(), but any region of the destination
+ *  can be computed on its own, from only the part of the source it depends
+ *  on.
+ */
+class Resampler
+{
+public:
+    /*! @brief Primary constructor.
+     *
+     *  @param srcWidth Width of the source.
+     *  @param srcHeight Height of the source.
+     *  @param dstWidth Width of the destination.
+     *  @param dstHeight Height of the destination.
+     *  @param filter Reconstruction filter.
+     */
+    Resampler(int srcWidth, int srcHeight, int dstWidth, int dstHeight, ResampleFilter filter=ResampleFilter::BILINEAR);
+
+    /*! @brief Finds the part of the source that a region depends on.
+     *
+     *  @param x X coordinate of the destination region.
+     *  @param y Y coordinate of the destination region.
+     *  @param w Width of the destination region.
+     *  @param h Height of the destination region.
+     *  @param[out] sx X coordinate of the source region.
+     *  @param[out] sy Y coordinate of the source region.
+     *  @param[out] sw Width of the source region.
+     *  @param[out] sh Height of the source region.
+     */
+    void getSource(int x, int y, int w, int h, int& sx, int& sy, int& sw, int& sh) const;
+
+    /*! @brief Resamples a region.
+     *
+     *  @param src Source region, at least the one given by getSource().
+     *  @param sx X coordinate of @a src in the source.
+     *  @param sy Y coordinate of @a src in the source.
+     *  @param dst Destination region.
+     *  @param x X coordinate of @a dst in the destination.
+     *  @param y Y coordinate of @a dst in the destination.
+     */
+    void apply(ConstImageView src, int sx, int sy, ImageView dst, int x, int y) const;
+
+private:
+    class Axis;
+
+    ResampleFilter filter;
+    std::shared_ptr<const Axis> tx;  //!< Taps along the X axis.
+    std::shared_ptr<const Axis> ty;  //!< Taps along the Y axis.
+};
+
+/*! @brief Resamples a view to the size of another.
+ *
+ *  Filters are separable and widen when downscaling, so every source pixel
+ *  contributes. Colors are filtered with premultiplied alpha, so transparent
+ *  pixels do not bleed into their neighbors. Edges are extended by
+ *  repeating the border pixels.
+ *
+ *  @note @a dst must not overlap @a src.
+ *
+ *  @param src Source view.
+ *  @param dst Destination view.
+ *  @param filter Reconstruction filter.
+ */
+void resample(ConstImageView src, ImageView dst, ResampleFilter filter=ResampleFilter::BILINEAR);
+
+/*! @brief Resamples a view to a new size.
+ *
+ *  @param img Source view.
+ *  @param w New width.
+ *  @param h New height.
+ *  @param filter Reconstruction filter.
+ *
+ *  @return Resampled image.
+ */
+Image resample(ConstImageView img, int w, int h, ResampleFilter filter=ResampleFilter::BILINEAR);
+
+} // namespace Inugami
+
+#endif // INUGAMI_RESAMPLE_H
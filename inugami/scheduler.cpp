@@ -0,0 +1,313 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+namespace Inugami {
+
+namespace {
+
+struct Later
+{
+    template <typename T>
+    bool operator()(const T& a, const T& b) const
+    {
+        return (a.due > b.due);
+    }
+};
+
+} // namespace
+
+Scheduler::Timer::Timer()
+    : share()
+    , index(0)
+    , generation(0)
+{}
+
+Scheduler::Timer::Timer(const std::shared_ptr<Shared>& s, std::size_t i, unsigned int g)
+    : share(s)
+    , index(i)
+    , generation(g)
+{}
+
+Scheduler::Shared* Scheduler::Timer::lock(std::shared_ptr<Shared>& s) const
+{
+    s = share.lock();
+    if (!s || s->slots[index].generation != generation) return nullptr;
+    return s.get();
+}
+
+bool Scheduler::Timer::isActive() const
+{
+    std::shared_ptr<Shared> s;
+    return (lock(s) != nullptr);
+}
+
+void Scheduler::Timer::cancel()
+{
+    std::shared_ptr<Shared> s;
+    if (lock(s)) s->release(index);
+}
+
+void Scheduler::Timer::reschedule(double delay)
+{
+    std::shared_ptr<Shared> s;
+    if (!lock(s) || s->slots[index].continuous) return;
+    s->schedule(index, Clock::now() + toDuration(delay));
+}
+
+Scheduler::Shared::Shared()
+    : slots()
+    , freeSlots()
+    , heap()
+    , continuous()
+{}
+
+std::size_t Scheduler::Shared::acquire(std::function<void()>&& func)
+{
+    std::size_t index;
+
+    if (freeSlots.empty())
+    {
+        index = slots.size();
+        slots.push_back(Slot{nullptr, Clock::duration::zero(), Clock::time_point(), 0, 0, false, false, false});
+    }
+    else
+    {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    auto& slot = slots[index];
+    slot.func = std::move(func);
+    slot.active = true;
+
+    return index;
+}
+
+void Scheduler::Shared::schedule(std::size_t index, Clock::time_point due)
+{
+    auto& slot = slots[index];
+    slot.due = due;
+    ++slot.serial;
+
+    heap.push_back(Entry{due, index, slot.serial});
+    std::push_heap(heap.begin(), heap.end(), Later());
+
+    if (heap.size() > 2*(slots.size()-freeSlots.size()) + 64) compact();
+}
+
+void Scheduler::Shared::release(std::size_t index)
+{
+    auto& slot = slots[index];
+
+    if (slot.continuous)
+    {
+        continuous.erase(std::find(continuous.begin(), continuous.end(), index));
+    }
+
+    slot.func = nullptr;
+    slot.active = false;
+    slot.continuous = false;
+    ++slot.generation;
+    ++slot.serial;
+
+    freeSlots.push_back(index);
+}
+
+void Scheduler::Shared::compact()
+{
+    auto stale = [&](const Entry& e)
+    {
+        return (e.serial != slots[e.index].serial);
+    };
+
+    heap.erase(std::remove_if(heap.begin(), heap.end(), stale), heap.end());
+    std::make_heap(heap.begin(), heap.end(), Later());
+}
+
+Scheduler::Scheduler()
+    : share(std::make_shared<Shared>())
+{}
+
+Scheduler::Timer Scheduler::addRepeating(std::function<void()> func, double freq)
+{
+    if (freq == 0.0) return Timer();
+
+    std::size_t index = share->acquire(std::move(func));
+    auto& slot = share->slots[index];
+    slot.repeating = true;
+
+    if (freq < 0.0)
+    {
+        slot.continuous = true;
+        share->continuous.push_back(index);
+    }
+    else
+    {
+        slot.continuous = false;
+        slot.period = toDuration(1.0/freq);
+        share->schedule(index, Clock::now() + slot.period);
+    }
+
+    return makeTimer(index);
+}
+
+Scheduler::Timer Scheduler::addOneShot(std::function<void()> func, double delay)
+{
+    std::size_t index = share->acquire(std::move(func));
+    auto& slot = share->slots[index];
+    slot.repeating = false;
+    slot.continuous = false;
+    slot.period = Clock::duration::zero();
+    share->schedule(index, Clock::now() + toDuration(delay));
+
+    return makeTimer(index);
+}
+
+void Scheduler::clear()
+{
+    for (std::size_t i=0; i<share->slots.size(); ++i)
+    {
+        if (share->slots[i].active) share->release(i);
+    }
+    share->heap.clear();
+}
+
+Scheduler::Clock::time_point Scheduler::dispatch(const bool& running)
+{
+    auto now = Clock::now();
+    auto& slots = share->slots;
+    auto& heap = share->heap;
+
+    //Calls the function of a slot, which may cancel or replace the timer
+    auto call = [&](std::size_t index)
+    {
+        auto& slot = slots[index];
+        unsigned int generation = slot.generation;
+        auto func = std::move(slot.func);
+        slot.func = nullptr;
+
+        auto restore = [&]
+        {
+            if (slot.generation == generation) slot.func = std::move(func);
+        };
+
+        try
+        {
+            func();
+        }
+        catch (...)
+        {
+            restore();
+            throw;
+        }
+
+        restore();
+    };
+
+    auto continuous = share->continuous;
+    for (auto index : continuous)
+    {
+        if (!running) break;
+        if (slots[index].continuous) call(index);
+    }
+
+    while (running && !heap.empty())
+    {
+        Entry top = heap.front();
+        auto& slot = slots[top.index];
+
+        if (top.serial == slot.serial && top.due > now) break;
+
+        std::pop_heap(heap.begin(), heap.end(), Later());
+        heap.pop_back();
+
+        if (top.serial != slot.serial) continue;
+
+        if (slot.repeating)
+        {
+            auto next = top.due + slot.period;
+            if (next <= now) next = now + slot.period;
+            share->schedule(top.index, next);
+            call(top.index);
+        }
+        else
+        {
+            unsigned int generation = slot.generation;
+            unsigned int serial = slot.serial;
+
+            //Releases the slot unless the function rescheduled or replaced it
+            auto done = [&]
+            {
+                if (slot.generation == generation && slot.serial == serial)
+                {
+                    share->release(top.index);
+                }
+            };
+
+            try
+            {
+                call(top.index);
+            }
+            catch (...)
+            {
+                done();
+                throw;
+            }
+
+            done();
+        }
+    }
+
+    if (!share->continuous.empty()) return Clock::time_point::min();
+
+    while (!heap.empty() && heap.front().serial != slots[heap.front().index].serial)
+    {
+        std::pop_heap(heap.begin(), heap.end(), Later());
+        heap.pop_back();
+    }
+
+    if (heap.empty()) return Clock::time_point::max();
+    return heap.front().due;
+}
+
+Scheduler::Clock::duration Scheduler::toDuration(double seconds) //static
+{
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds)
+    );
+}
+
+Scheduler::Timer Scheduler::makeTimer(std::size_t index) const
+{
+    return Timer(share, index, share->slots[index].generation);
+}
+
+} // namespace Inugami
@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_SCHEDULER_H
+#define INUGAMI_SCHEDULER_H
+
+#include "inugami.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Timer scheduler.
+ *
+ *  Keeps pending timers in a binary min-heap ordered by deadline, so
+ *  dispatching costs @a O(log n) per timer that fires, no matter how many
+ *  timers are waiting. Timers are stored in recycled slots, and canceled or
+ *  rescheduled timers leave stale heap entries behind that are dropped when
+ *  they reach the top.
+ */
+class Scheduler
+{
+    class Shared;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /*! @brief Timer handle.
+     *
+     *  Handles are cheap to copy and don't keep the timer alive. A handle to
+     *  a timer that has fired, was canceled, or whose Scheduler is gone is
+     *  inactive, and every operation on it does nothing.
+     */
+    class Timer
+    {
+        friend class Scheduler;
+    public:
+        /*! @brief Default constructor.
+         *
+         *  Constructs an inactive handle.
+         */
+        Timer();
+
+        /*! @brief Returns @a true if the timer is still scheduled.
+         */
+        bool isActive() const;
+
+        /*! @brief Cancels the timer.
+         */
+        void cancel();
+
+        /*! @brief Moves the timer's next call.
+         *
+         *  Repeating timers keep their period after the next call.
+         *
+         *  @param delay Seconds from now.
+         */
+        void reschedule(double delay);
+
+    private:
+        Timer(const std::shared_ptr<Shared>& s, std::size_t i, unsigned int g);
+
+        Shared* lock(std::shared_ptr<Shared>& s) const;
+
+        std::weak_ptr<Shared> share;
+        std::size_t index;
+        unsigned int generation;
+    };
+
+    /*! @brief Default constructor.
+     */
+    Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /*! @brief Adds a repeating timer.
+     *
+     *  A negative frequency calls @a func on every dispatch(), and a
+     *  frequency of zero never calls it.
+     *
+     *  @param func Function to call.
+     *  @param freq Call frequency, in Hertz.
+     *
+     *  @return Handle to the timer.
+     */
+    Timer addRepeating(std::function<void()> func, double freq);
+
+    /*! @brief Adds a one-shot timer.
+     *
+     *  @param func Function to call.
+     *  @param delay Seconds from now.
+     *
+     *  @return Handle to the timer.
+     */
+    Timer addOneShot(std::function<void()> func, double delay);
+
+    /*! @brief Cancels every timer.
+     */
+    void clear();
+
+    /*! @brief Calls every timer that is due.
+     *
+     *  Timers may be added, canceled and rescheduled from inside their
+     *  functions.
+     *
+     *  @param running Dispatching stops as soon as this becomes @a false.
+     *
+     *  @return Deadline of the next timer. This is @a Clock::time_point::min()
+     *  if a timer runs on every dispatch, and @a Clock::time_point::max() if
+     *  there are no timers.
+     */
+    Clock::time_point dispatch(const bool& running);
+
+private:
+    struct Slot
+    {
+        std::function<void()> func;
+        Clock::duration period;
+        Clock::time_point due;
+        unsigned int generation;
+        unsigned int serial;
+        bool active;
+        bool repeating;
+        bool continuous;
+    };
+
+    struct Entry
+    {
+        Clock::time_point due;
+        std::size_t index;
+        unsigned int serial;
+    };
+
+    class Shared
+    {
+    public:
+        Shared();
+
+        std::size_t acquire(std::function<void()>&& func);
+        void schedule(std::size_t index, Clock::time_point due);
+        void release(std::size_t index);
+        void compact();
+
+        std::deque<Slot> slots;
+        std::vector<std::size_t> freeSlots;
+        std::vector<Entry> heap;
+        std::vector<std::size_t> continuous;
+    };
+
+    static Clock::duration toDuration(double seconds);
+
+    Timer makeTimer(std::size_t index) const;
+
+    std::shared_ptr<Shared> share;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_SCHEDULER_H
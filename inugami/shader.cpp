@@ -30,7 +30,17 @@
 #include "loaders.hpp"
 #include "shaderprogram.hpp"
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 #include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -39,6 +49,23 @@ namespace Inugami {
 
 thread_local GLuint Shader::boundProgram = 0;
 
+std::string Shader::binaryCache;
+
+constexpr GLuint Shader::FRAME_BINDING;
+
+const char* const Shader::FRAME_BLOCK =
+    "layout (std140) uniform Frame\n"
+    "{\n"
+    "    mat4 viewMatrix;\n"
+    "    mat4 projectionMatrix;\n"
+    "    mat4 viewProjection;\n"
+    "    vec2 screenSize;\n"
+    "    float time;\n"
+    "};\n"
+;
+
+static_assert(sizeof(Shader::FrameBlock) == 208, "FrameBlock does not match std140 layout.");
+
 const char* ShaderException::what() const noexcept
 {
     return err.c_str();
@@ -90,14 +117,86 @@ ShaderE_UniformShaderError::ShaderE_UniformShaderError()
     err = ss.str();
 }
 
+void Shader::setBinaryCache(const std::string& dir) //static
+{
+    binaryCache = dir;
+    if (dir.empty()) return;
+
+    // Fails harmlessly if the directory already exists.
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+}
+
+ShaderE_FeatureError::ShaderE_FeatureError(const std::string& name)
+{
+    std::stringstream ss;
+    ss << "Shader feature error: Unknown feature \"" << name << "\"!";
+    err = ss.str();
+}
+
+class Shader::Variants
+{
+public:
+    Variants(const ShaderProgram& s, bool a)
+        : source(s)
+        , async(a)
+        , cache()
+    {}
+    ShaderProgram source;
+    bool async;
+    std::unordered_map<std::uint32_t,std::shared_ptr<Shared>> cache;
+};
+
+std::uint32_t Shader::feature(const std::string& name) const
+{
+    if (variants)
+    {
+        auto&& features = variants->source.features;
+        for (std::size_t i=0; i<features.size() && i<32; ++i)
+        {
+            if (features[i] == name) return (std::uint32_t(1) << i);
+        }
+    }
+    throw ShaderE_FeatureError(name);
+}
+
 #ifndef INU_NO_SHADERS
 
+namespace {
+
+std::uint64_t hashBytes(std::uint64_t hash, const void* data, std::size_t len)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i=0; i<len; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Precedes the program binary in a cache file. The key is checked on load, so
+// a stale or colliding file is rejected without reaching the driver.
+struct BinaryHeader
+{
+    char magic[8];
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t size;
+};
+
+const char BINARY_MAGIC[8] = {'I','N','U','S','H','B','I','N'};
+
+} // namespace
+
 Shader::Uniform::Uniform()
     : shader(nullptr)
     , data(nullptr)
 {}
 
-Shader::Uniform::Uniform(const Shader* s, const UniformData* u)
+Shader::Uniform::Uniform(const Shader* s, UniformData* u)
     : shader(s)
     , data(u)
 {}
@@ -105,34 +204,157 @@ Shader::Uniform::Uniform(const Shader* s, const UniformData* u)
 Shader::Shared::Shared()
     : program(glCreateProgram())
     , uniforms()
+    , ready(false)
+    , stages()
+    , stageSources()
+    , cacheKey(0)
+    , cacheOnLink(false)
 {}
 
 Shader::Shared::~Shared()
 {
+    for (auto&& id : stages) glDeleteShader(id);
     glDeleteProgram(program);
 }
 
-Shader::Shader(const ShaderProgram &source)
+Shader::Shader(const ShaderProgram &source, bool async)
     : share(std::make_shared<Shared>())
+    , variants(std::make_shared<Variants>(source, async))
+{
+    variants->cache[0] = share;
+    build(source, async);
+}
+
+Shader Shader::variant(std::uint32_t features) const
+{
+    if (!variants)
+    {
+        if (features == 0) return *this;
+        std::stringstream ss;
+        ss << "0x" << std::hex << features;
+        throw ShaderE_FeatureError(ss.str());
+    }
+
+    std::size_t count = variants->source.features.size();
+    if (count < 32) features &= (std::uint32_t(1) << count) - 1;
+
+    Shader rval;
+    rval.variants = variants;
+
+    auto&& cached = variants->cache[features];
+    if (!cached)
+    {
+        rval.share = std::make_shared<Shared>();
+        rval.build(variants->source.withFeatures(features), variants->async);
+        cached = rval.share;
+    }
+
+    rval.share = cached;
+    return rval;
+}
+
+void Shader::build(const ShaderProgram& source, bool async)
+{
+    bool useCache = (!binaryCache.empty() && GLEW_ARB_get_program_binary);
+    if (useCache) share->cacheKey = binaryKey(source);
+
+    if (useCache && loadBinary(share->cacheKey))
+    {
+        initProgram();
+        return;
+    }
+
+    share->cacheOnLink = useCache;
+    link(source);
+
+    if (!async) finish();
+}
+
+void Shader::setParallelCompile(unsigned threads) //static
 {
-    auto compile = [](const GLuint id, const std::string &codeStr)
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(threads);
+    }
+    else if (GLEW_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(threads);
+    }
+}
+
+bool Shader::isReady() const
+{
+    if (share->ready) return true;
+
+    if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)
+    {
+        GLint status = GL_FALSE;
+        glGetProgramiv(share->program, GL_COMPLETION_STATUS_KHR, &status);
+        if (status == GL_FALSE) return false;
+    }
+
+    finish();
+    return true;
+}
+
+void Shader::finish() const
+{
+    if (share->ready) return;
+
+    auto stages = std::move(share->stages);
+    auto sources = std::move(share->stageSources);
+    share->stages.clear();
+    share->stageSources.clear();
+
+    auto cleanup = [&]
+    {
+        for (auto &p : stages)
+        {
+            glDetachShader(share->program, p);
+            glDeleteShader(p);
+        }
+    };
+
+    for (std::size_t i=0; i<stages.size(); ++i)
     {
-        const GLchar* code = codeStr.c_str();
-        const GLchar* codeVec[] = {code};
-        glShaderSource(id, 1, codeVec, nullptr);
-        glCompileShader(id);
         GLint status;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+        glGetShaderiv(stages[i], GL_COMPILE_STATUS, &status);
         if (status == GL_FALSE)
         {
             GLsizei len = 0;
-            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &len);
+            glGetShaderiv(stages[i], GL_INFO_LOG_LENGTH, &len);
+            std::vector<GLchar> log(len+1);
+            glGetShaderInfoLog(stages[i], len+1, &len, &log[0]);
+            cleanup();
+            throw ShaderE_CompileError(sources[i], &log[0]);
+        }
+    }
+
+    GLint status;
+    glGetProgramiv(share->program, GL_LINK_STATUS, &status);
+
+    if (status == GL_FALSE)
+    {
+        GLsizei len = 0;
+        glGetProgramiv(share->program, GL_INFO_LOG_LENGTH, &len);
+        if (len>=1)
+        {
             std::vector<GLchar> log(len);
-            glGetShaderInfoLog(id, 1024, &len, &log[0]);
-            throw ShaderE_CompileError(codeStr, &log[0]);
+            glGetProgramInfoLog(share->program, len, &len, &log[0]);
+            cleanup();
+            throw ShaderE_LinkError(&log[0]);
         }
-    };
+    }
+
+    cleanup();
+
+    if (share->cacheOnLink) saveBinary(share->cacheKey);
+
+    initProgram();
+}
 
+void Shader::link(const ShaderProgram& source)
+{
     static constexpr GLuint shaderTypes[5] = {
         GL_VERTEX_SHADER,
         GL_TESS_CONTROL_SHADER,
@@ -141,48 +363,112 @@ Shader::Shader(const ShaderProgram &source)
         GL_FRAGMENT_SHADER
     };
 
-    std::vector<GLuint> ids;
-
     for (int i=0; i<5; ++i)
     {
         if (source.sources[i] != "")
         {
             GLuint shader = glCreateShader(shaderTypes[i]);
-            ids.push_back(shader);
-            compile(shader, source.sources[i]);
+            const GLchar* code = source.sources[i].c_str();
+            glShaderSource(shader, 1, &code, nullptr);
+            glCompileShader(shader);
+            share->stages.push_back(shader);
+            share->stageSources.push_back(source.sources[i]);
         }
     }
 
-    for (auto &p : ids) glAttachShader(share->program, p);
+    for (auto &p : share->stages) glAttachShader(share->program, p);
+    if (share->cacheOnLink)
+    {
+        glProgramParameteri(share->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(share->program);
+}
 
-    GLint status;
-    glGetProgramiv(share->program, GL_LINK_STATUS, &status);
+void Shader::initProgram() const
+{
+    GLuint frameIndex = glGetUniformBlockIndex(share->program, "Frame");
+    if (frameIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(share->program, frameIndex, FRAME_BINDING);
+    }
 
-    if (status == GL_FALSE)
+    initUniforms();
+
+    share->ready = true;
+}
+
+std::uint64_t Shader::binaryKey(const ShaderProgram& source) //static
+{
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (auto&& src : source.sources)
     {
-        GLsizei len = 0;
-        glGetProgramiv(share->program, GL_INFO_LOG_LENGTH, &len);
-        if (len>=1)
-        {
-            std::vector<GLchar> log(len);
-            glGetProgramInfoLog(share->program, len, &len, &log[0]);
-            throw ShaderE_LinkError(&log[0]);
-        }
+        hash = hashBytes(hash, src.c_str(), src.size()+1);
     }
 
-    for (auto &p : ids)
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
     {
-        glDetachShader(share->program, p);
-        glDeleteShader(p);
+        auto str = reinterpret_cast<const char*>(glGetString(name));
+        if (str) hash = hashBytes(hash, str, std::strlen(str)+1);
     }
 
-    initUniforms();
+    return hash;
+}
+
+std::string Shader::binaryPath(std::uint64_t key) //static
+{
+    std::stringstream ss;
+    ss << binaryCache << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return ss.str();
+}
+
+bool Shader::loadBinary(std::uint64_t key)
+{
+    std::ifstream file(binaryPath(key), std::ios::binary);
+
+    BinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) return false;
+    if (header.key != key || header.size == 0) return false;
+
+    std::vector<char> data (
+          (std::istreambuf_iterator<char>(file))
+        , std::istreambuf_iterator<char>()
+    );
+    if (data.size() != header.size) return false;
+
+    glProgramBinary(share->program, header.format, &data[0], data.size());
+
+    GLint status;
+    glGetProgramiv(share->program, GL_LINK_STATUS, &status);
+    return (status == GL_TRUE);
+}
+
+void Shader::saveBinary(std::uint64_t key) const
+{
+    GLint len = 0;
+    glGetProgramiv(share->program, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0) return;
+
+    std::vector<char> data(len);
+    GLenum format = 0;
+    glGetProgramBinary(share->program, len, nullptr, &format, &data[0]);
+
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.key = key;
+    header.format = format;
+    header.size = len;
+
+    std::ofstream file(binaryPath(key), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(&data[0], len);
 }
 
 void Shader::bind() const
 {
     if (isBound()) return;
+    finish();
     glUseProgram(share->program);
     boundProgram = share->program;
 }
@@ -192,30 +478,62 @@ bool Shader::isBound() const
     return (boundProgram == share->program);
 }
 
-Shader::Uniform Shader::uniform(const std::string& name) const
+Shader::Uniform Shader::uniform(const UniformName& name) const
 {
-    auto iter = share->uniforms.find(name);
-    if (iter == share->uniforms.end()) return Uniform(this, nullptr);
-    return Uniform(this, &iter->second);
+    return Uniform(this, getUniform(name));
 }
 
-void Shader::initUniforms()
+void Shader::initUniforms() const
 {
     GLint numUniforms, maxLength;
 
     glGetProgramiv(share->program, GL_ACTIVE_UNIFORMS, &numUniforms);
     glGetProgramiv(share->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
 
-    GLchar* name = new GLchar[maxLength];
-    UniformData tmpUniform;
+    std::vector<GLchar> name(maxLength);
+    UniformData tmpUniform = {};
     for (int i=0; i<numUniforms; ++i)
     {
-        glGetActiveUniform(share->program, i, maxLength, nullptr, &tmpUniform.size, &tmpUniform.type, name);
-        tmpUniform.location = glGetUniformLocation(share->program, name);
-        share->uniforms[name] = tmpUniform;
+        glGetActiveUniform(share->program, i, maxLength, nullptr, &tmpUniform.size, &tmpUniform.type, &name[0]);
+        tmpUniform.location = glGetUniformLocation(share->program, &name[0]);
+        if (tmpUniform.location == -1) continue; // Uniform block member
+        if (!share->uniforms.emplace(UniformName(&name[0]).hash, tmpUniform).second)
+        {
+            throw ShaderE_LinkError(std::string("Uniform name hash collision: ") + &name[0]);
+        }
+    }
+}
+
+Shader::UniformStats Shader::getUniformStats() const
+{
+    UniformStats rval = {0, 0};
+    if (!share) return rval;
+    for (auto&& u : share->uniforms)
+    {
+        rval.issued  += u.second.issued;
+        rval.skipped += u.second.skipped;
+    }
+    return rval;
+}
+
+void Shader::resetUniformStats() const
+{
+    if (!share) return;
+    for (auto&& u : share->uniforms)
+    {
+        u.second.issued  = 0;
+        u.second.skipped = 0;
     }
 }
 
+Shader::UniformData* Shader::getUniform(const UniformName& name) const
+{
+    finish();
+    auto iter = share->uniforms.find(name.hash);
+    if (iter == share->uniforms.end()) return nullptr;
+    return &iter->second;
+}
+
 #else
 
 Shader::Uniform::Uniform()
@@ -223,7 +541,7 @@ Shader::Uniform::Uniform()
     , data(nullptr)
 {}
 
-Shader::Uniform::Uniform(const Shader* s, const UniformData* u)
+Shader::Uniform::Uniform(const Shader* s, UniformData* u)
     : shader(s)
     , data(u)
 {}
@@ -231,17 +549,39 @@ Shader::Uniform::Uniform(const Shader* s, const UniformData* u)
 Shader::Shared::Shared()
     : program()
     , uniforms()
+    , ready(true)
+    , stages()
+    , stageSources()
+    , cacheKey(0)
+    , cacheOnLink(false)
 {}
 
 Shader::Shared::~Shared()
 {}
 
-Shader::Shader(const ShaderProgram &source)
+Shader::Shader(const ShaderProgram &source, bool)
     : share()
+    , variants(std::make_shared<Variants>(source, false))
 {
     initUniforms();
 }
 
+Shader Shader::variant(std::uint32_t) const
+{
+    return *this;
+}
+
+void Shader::setParallelCompile(unsigned) //static
+{}
+
+bool Shader::isReady() const
+{
+    return true;
+}
+
+void Shader::finish() const
+{}
+
 void Shader::bind() const
 {}
 
@@ -250,14 +590,27 @@ bool Shader::isBound() const
     return false;
 }
 
-Shader::Uniform Shader::uniform(const std::string&) const
+Shader::Uniform Shader::uniform(const UniformName&) const
 {
     return Uniform(this, nullptr);
 }
 
-void Shader::initUniforms()
+void Shader::initUniforms() const
+{}
+
+Shader::UniformStats Shader::getUniformStats() const
+{
+    return {0, 0};
+}
+
+void Shader::resetUniformStats() const
 {}
 
+Shader::UniformData* Shader::getUniform(const UniformName&) const
+{
+    return nullptr;
+}
+
 #endif // INU_NO_SHADERS
 
 } // namespace Inugami
@@ -31,13 +31,18 @@
 #include "inugami.hpp"
 
 #include "exception.hpp"
+#include "mathtypes.hpp"
 #include "opengl.hpp"
 #include "utility.hpp"
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <list>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Inugami {
 
@@ -88,6 +93,47 @@ public:
     ShaderE_UniformShaderError();
 };
 
+class ShaderE_FeatureError
+    : public ShaderException
+{
+public:
+    ShaderE_FeatureError(const std::string& name);
+};
+
+/*! @brief Hashed uniform name.
+ *
+ *  Uniforms are looked up by the FNV-1a hash of their name. The hash of a
+ *  string literal can be computed at compile time, so resolving a uniform
+ *  does not need to construct a @a std::string.
+ */
+class UniformName
+{
+public:
+    /*! @brief Hashes a C string.
+     *
+     *  @param name Name of uniform.
+     */
+    constexpr UniformName(const char* name)
+        : hash(hashString(name, 2166136261u))
+    {}
+
+    /*! @brief Hashes a string.
+     *
+     *  @param name Name of uniform.
+     */
+    UniformName(const std::string& name)
+        : hash(hashString(name.c_str(), 2166136261u))
+    {}
+
+    std::uint32_t hash; //!< FNV-1a hash of the name.
+
+private:
+    static constexpr std::uint32_t hashString(const char* s, std::uint32_t h)
+    {
+        return (*s ? hashString(s+1, (h ^ std::uint8_t(*s)) * 16777619u) : h);
+    }
+};
+
 /*! @brief Shader handle.
  *
  *  This object manages shader programs for OpenGL.
@@ -99,16 +145,71 @@ class Shader
         GLenum type;
         GLint size;
         GLint location;
+        bool cached;
+        std::array<unsigned char,64> value;
+        unsigned long issued;
+        unsigned long skipped;
     };
 
+    template <typename T>
+    static bool shadow(UniformData& data, const T& t)
+    {
+        static_assert(sizeof(T) <= sizeof(data.value), "Uniform type too large to shadow.");
+        if (data.cached && std::memcmp(&data.value[0], &t, sizeof(T)) == 0)
+        {
+            ++data.skipped;
+            return false;
+        }
+        std::memcpy(&data.value[0], &t, sizeof(T));
+        data.cached = true;
+        ++data.issued;
+        return true;
+    }
+
 public:
+    /*! @brief Contents of the frame uniform block.
+     *
+     *  Matches the std140 layout of FRAME_BLOCK.
+     */
+    struct FrameBlock
+    {
+        Mat4 viewMatrix;
+        Mat4 projectionMatrix;
+        Mat4 viewProjection;
+        Vec2 screenSize;
+        float time;
+        float padding;
+    };
+
+    /*! @brief Binding point of the frame uniform block.
+     */
+    static constexpr GLuint FRAME_BINDING = 0;
+
+    /*! @brief GLSL declaration of the frame uniform block.
+     *
+     *  Shaders which declare this block have it bound to FRAME_BINDING when
+     *  they are linked. The block is updated by Core::applyCam(), so it stays
+     *  valid across shader switches.
+     */
+    static const char* const FRAME_BLOCK;
+
+    /*! @brief Uniform set counters.
+     *
+     *  Sets are skipped when the value is the same as the last value set.
+     */
+    struct UniformStats
+    {
+        unsigned long issued;   //!< Sets sent to OpenGL.
+        unsigned long skipped;  //!< Sets skipped.
+    };
+
     class Uniform
     {
         const Shader* shader;
-        const UniformData* data;
+        UniformData* data;
     public:
         Uniform();
-        Uniform(const Shader* s, const UniformData* u);
+        Uniform(const Shader* s, UniformData* u);
 
         template <typename T>
         bool set(T&& t)
@@ -121,11 +222,61 @@ public:
             if (!GT::isValidType(data->type)) throw ShaderE_UniformTypeError();
             if (!shader->isBound()          ) throw ShaderE_UniformBindError();
 
-            GT::uniformFunc(data->location, std::forward<T>(t));
+            if (shadow<typename std::decay<T>::type>(*data, t))
+            {
+                GT::uniformFunc(data->location, std::forward<T>(t));
+            }
             return true;
         }
     };
 
+    /*! @brief Pre-resolved uniform handle.
+     *
+     *  The uniform's type is validated once, when the handle is resolved by
+     *  Shader::uniformHandle(). Setting it is then a single @a glUniform call.
+     *  A handle to a uniform which is not active in the shader is valid, but
+     *  setting it does nothing.
+     *
+     *  @note Unless @a NDEBUG is defined, set() still checks that the shader
+     *  is bound.
+     */
+    template <typename T>
+    class TypedUniform
+    {
+        GLuint program;
+        UniformData* data;
+    public:
+        TypedUniform()
+            : program(0)
+            , data(nullptr)
+        {}
+
+        TypedUniform(GLuint p, UniformData* d)
+            : program(p)
+            , data(d)
+        {}
+
+        /*! @brief Returns @a true if the uniform is active in the shader.
+         */
+        bool isActive() const
+        {
+            return (data != nullptr);
+        }
+
+        /*! @brief Sets the uniform.
+         *
+         *  @param t Value to set.
+         */
+        void set(const T& t) const
+        {
+            if (!data) return;
+#ifndef NDEBUG
+            if (program != boundProgram) throw ShaderE_UniformBindError();
+#endif // NDEBUG
+            if (shadow(*data, t)) GLType<T>::uniformFunc(data->location, t);
+        }
+    };
+
     /*! @brief Default constructor.
      */
     Shader() = default;
@@ -136,9 +287,83 @@ public:
      *  does not need to contain every type of shader, but at least a vertex
      *  and fragment shader are recommended.
      *
+     *  If @a async is @a true, every stage is compiled and the program is
+     *  linked without waiting for the results. Use isReady() to poll for
+     *  completion. Compile and link errors are thrown once the shader is
+     *  finished, which happens implicitly on first use.
+     *
      *  @param in ShaderProgram to upload.
+     *  @param async Don't wait for compilation to complete.
+     */
+    Shader(const ShaderProgram &in, bool async = false);
+
+    /*! @brief Sets the number of driver compiler threads.
+     *
+     *  Only has an effect when @a KHR_parallel_shader_compile or
+     *  @a ARB_parallel_shader_compile is available.
+     *
+     *  @param threads Maximum number of threads, @a 0xFFFFFFFF for the
+     *  driver's choice.
      */
-    Shader(const ShaderProgram &in);
+    static void setParallelCompile(unsigned threads);
+
+    /*! @brief Gets the bit of a feature.
+     *
+     *  @param name Name of a feature in ShaderProgram::features.
+     *
+     *  @return Bit to pass to variant().
+     *
+     *  @throw ShaderE_FeatureError if the feature doesn't exist.
+     */
+    std::uint32_t feature(const std::string& name) const;
+
+    /*! @brief Gets a variant of the shader.
+     *
+     *  A variant is compiled from the same ShaderProgram, with the selected
+     *  features defined as preprocessor macros. Variants are compiled on
+     *  first request, in the same mode as this shader, and are cached by
+     *  their features. Every variant shares the cache.
+     *
+     *  @param features Bitwise OR of feature() bits. @a 0 selects the
+     *  original program.
+     *
+     *  @return Handle to the variant.
+     *
+     *  @throw ShaderE_FeatureError if features are requested from a shader
+     *  that was not built from a ShaderProgram.
+     */
+    Shader variant(std::uint32_t features) const;
+
+    /*! @brief Sets the program binary cache directory.
+     *
+     *  Linked programs are saved to this directory, and are reloaded instead
+     *  of compiled the next time the same sources are used with the same
+     *  driver. An empty string, the default, disables the cache.
+     *
+     *  The directory is created if it doesn't exist, but its parent must.
+     *  Use a directory of its own, since the files are specific to the
+     *  driver.
+     *
+     *  @param dir Cache directory.
+     */
+    static void setBinaryCache(const std::string& dir);
+
+    /*! @brief Returns @a true if the shader is finished and can be used.
+     *
+     *  Never blocks when @a KHR_parallel_shader_compile is available.
+     *  Otherwise, the driver can't be polled, so the shader is finished
+     *  immediately.
+     *
+     *  @throw ShaderE_CompileError or ShaderE_LinkError if the shader has
+     *  just finished and failed.
+     */
+    bool isReady() const;
+
+    /*! @brief Waits for the shader to finish compiling.
+     *
+     *  @throw ShaderE_CompileError or ShaderE_LinkError on failure.
+     */
+    void finish() const;
 
     /*! @brief Binds the shader.
      */
@@ -152,10 +377,38 @@ public:
      *
      *  @param name Name of uniform.
      */
-    Uniform uniform(const std::string& name) const;
+    Uniform uniform(const UniformName& name) const;
+
+    /*! @brief Resolves a typed uniform handle.
+     *
+     *  The returned handle stays valid for as long as the shader exists.
+     *
+     *  @param name Name of uniform.
+     *
+     *  @return Handle to the uniform.
+     *
+     *  @throw ShaderE_UniformTypeError if the uniform is not of type @a T.
+     */
+    template <typename T>
+    TypedUniform<T> uniformHandle(const UniformName& name) const
+    {
+        UniformData* data = getUniform(name);
+        if (!data) return TypedUniform<T>();
+        if (!GLType<T>::isValidType(data->type)) throw ShaderE_UniformTypeError();
+        return TypedUniform<T>(share->program, data);
+    }
+
+    /*! @brief Returns the uniform set counters of this shader's program.
+     */
+    UniformStats getUniformStats() const;
+
+    /*! @brief Resets the uniform set counters of this shader's program.
+     */
+    void resetUniformStats() const;
 
 private:
     static thread_local GLuint boundProgram;
+    static std::string binaryCache;
 
     class Shared
     {
@@ -163,13 +416,29 @@ private:
         Shared();
         ~Shared();
         GLuint program;
-        std::unordered_map<std::string,UniformData> uniforms;
+        std::unordered_map<std::uint32_t,UniformData> uniforms;
+        bool ready;
+        std::vector<GLuint> stages;
+        std::vector<std::string> stageSources;
+        std::uint64_t cacheKey;
+        bool cacheOnLink;
     };
 
-    void initUniforms();
-    const UniformData* getUniform(const std::string& name) const;
+    static std::uint64_t binaryKey(const ShaderProgram& source);
+    static std::string binaryPath(std::uint64_t key);
+
+    class Variants;
+
+    void build(const ShaderProgram& source, bool async);
+    void link(const ShaderProgram& source);
+    bool loadBinary(std::uint64_t key);
+    void saveBinary(std::uint64_t key) const;
+    void initProgram() const;
+    void initUniforms() const;
+    UniformData* getUniform(const UniformName& name) const;
 
     std::shared_ptr<Shared> share;
+    std::shared_ptr<Variants> variants;
 };
 
 } // namespace Inugami
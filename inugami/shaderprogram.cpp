@@ -29,6 +29,7 @@
 
 #include "exception.hpp"
 #include "loaders.hpp"
+#include "shader.hpp"
 
 #include <algorithm>
 #include <fstream>
@@ -42,12 +43,13 @@ ShaderProgram ShaderProgram::fromDefault() //static
 {
     ShaderProgram rval;
 
-    rval.sources[VERT] =
+    rval.sources[VERT] = std::string() +
         "#version 330\n"
         "layout (location = 0) in vec3 VertexPosition;\n"
         "layout (location = 1) in vec3 VertexNormal;\n"
         "layout (location = 2) in vec2 VertexTexCoord;\n"
-        "uniform mat4 MVP;\n"
+        + Shader::FRAME_BLOCK +
+        "uniform mat4 modelMatrix;\n"
         "out vec3 Position;\n"
         "out vec3 Normal;\n"
         "out vec2 TexCoord;\n"
@@ -56,7 +58,7 @@ ShaderProgram ShaderProgram::fromDefault() //static
         "    TexCoord = VertexTexCoord;\n"
         "    Normal = normalize(VertexNormal);\n"
         "    Position = VertexPosition;\n"
-        "    gl_Position = MVP * vec4(VertexPosition,1.0);\n"
+        "    gl_Position = viewProjection * modelMatrix * vec4(VertexPosition,1.0);\n"
         "}\n"
     ;
     rval.sources[FRAG] =
@@ -75,6 +77,27 @@ ShaderProgram ShaderProgram::fromDefault() //static
     return rval;
 }
 
+ShaderProgram ShaderProgram::fromDefaultArray() //static
+{
+    ShaderProgram rval = fromDefault();
+
+    rval.sources[FRAG] =
+        "#version 330\n"
+        "in vec3 Position;\n"
+        "in vec3 Normal;\n"
+        "in vec2 TexCoord;\n"
+        "uniform sampler2DArray Tex0;\n"
+        "uniform int TexLayer;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    vec4 texColor = texture( Tex0, vec3(TexCoord, TexLayer) );\n"
+        "    FragColor = texColor;\n"
+        "}\n"
+    ;
+
+    return rval;
+}
+
 ShaderProgram ShaderProgram::fromName(std::string in) //static
 {
     static std::unordered_map<std::string, Type> typeStrings = {
@@ -104,8 +127,39 @@ ShaderProgram ShaderProgram::fromName(std::string in) //static
     return rval;
 }
 
+ShaderProgram ShaderProgram::withFeatures(std::uint32_t mask) const
+{
+    ShaderProgram rval = *this;
+
+    std::string defines;
+    for (std::size_t i=0; i<features.size() && i<32; ++i)
+    {
+        if (mask & (std::uint32_t(1) << i)) defines += "#define " + features[i] + " 1\n";
+    }
+
+    if (defines.empty()) return rval;
+
+    for (auto&& src : rval.sources)
+    {
+        if (src == "") continue;
+
+        std::size_t pos = src.find("#version");
+        if (pos != std::string::npos)
+        {
+            pos = src.find('\n', pos);
+            pos = (pos == std::string::npos)? src.size() : pos+1;
+        }
+        else pos = 0;
+
+        src.insert(pos, defines);
+    }
+
+    return rval;
+}
+
 ShaderProgram::ShaderProgram()
     : sources(5, "")
+    , features()
 {}
 
 ShaderProgram::~ShaderProgram()
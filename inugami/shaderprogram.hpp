@@ -28,6 +28,7 @@
 #ifndef INUGAMI_SHADERPROGRAM_H
 #define INUGAMI_SHADERPROGRAM_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -61,6 +62,15 @@ public:
      */
     static ShaderProgram fromDefault();
 
+    /*! @brief Creates default texture array shader.
+     *
+     *  Same as fromDefault(), but samples layer @a TexLayer of a
+     *  @a sampler2DArray, for use with TextureArray.
+     *
+     *  @return Basic texture array shader.
+     */
+    static ShaderProgram fromDefaultArray();
+
     /*! @brief Creates shader from files.
      *
      *  Files beginning with the given prefix and ending with specific
@@ -72,6 +82,17 @@ public:
      */
     static ShaderProgram fromName(std::string in);
 
+    /*! @brief Creates a variant of this program.
+     *
+     *  Each feature whose bit is set in @a mask is defined as a preprocessor
+     *  macro, directly after the @a \#version line of every stage.
+     *
+     *  @param mask Features to define. Bit @a i selects @a features[i].
+     *
+     *  @return Program with the selected features defined.
+     */
+    ShaderProgram withFeatures(std::uint32_t mask) const;
+
     /*! @brief Default constructor.
      */
     ShaderProgram();
@@ -83,6 +104,12 @@ public:
     /*! @brief 5-element vector of sources.
      */
     std::vector<std::string> sources;
+
+    /*! @brief Names of optional features.
+     *
+     *  At most 32 features are supported. See Shader::variant().
+     */
+    std::vector<std::string> features;
 };
 
 } // namespace Inugami
@@ -43,6 +43,8 @@ Spritesheet::Spritesheet(const Image& img, int tw, int th, float cx, float cy)
 Spritesheet::Spritesheet(const Texture& in, int tw, int th, float cx, float cy)
     : tilesX(0)
     , tilesY(0)
+    , tileW(tw)
+    , tileH(th)
     , tex(in)
     , meshes()
 {
@@ -55,6 +57,27 @@ void Spritesheet::draw(int r, int c) const
     meshes[r*tilesX+c].draw();
 }
 
+std::vector<Image> Spritesheet::getTiles() const
+{
+    std::vector<Image> rval;
+    rval.reserve(tilesX*tilesY);
+
+    const Image img = tex.getImage();
+
+    for (int r = 0; r<tilesY; ++r)
+    {
+        // Images are stored bottom-up, so row 0 is at the top of the texture.
+        int y = (tilesY-r-1)*tileH;
+
+        for (int c = 0; c<tilesX; ++c)
+        {
+            rval.emplace_back(img.view().sub(c*tileW, y, tileW, tileH));
+        }
+    }
+
+    return rval;
+}
+
 void Spritesheet::generateMeshes(int tw, int th, float cx, float cy)
 {
     constexpr float E = 0.0f; // std::numeric_limits<float>::epsilon() * 1.0e4;
@@ -74,8 +74,19 @@ public:
      */
     void draw(int r, int c) const;
 
+    /*! @brief Extracts the tiles.
+     *
+     *  Reads the texture back and slices it into one Image per tile, in
+     *  row-major order. Used to convert a Spritesheet into a TextureArray.
+     *
+     *  @return Tile images.
+     */
+    std::vector<Image> getTiles() const;
+
     ConstAttr<int,Spritesheet> tilesX;  //!< Number of tile columns.
     ConstAttr<int,Spritesheet> tilesY;  //!< Number of tile rows.
+    ConstAttr<int,Spritesheet> tileW;   //!< Width of each tile, in pixels.
+    ConstAttr<int,Spritesheet> tileH;   //!< Height of each tile, in pixels.
 
 private:
     void generateMeshes(int tw, int th, float cx, float cy);
@@ -29,6 +29,8 @@
 
 #include "core.hpp"
 #include "loaders.hpp"
+#include "mappedimage.hpp"
+#include "textureresidency.hpp"
 #include "utility.hpp"
 #include "exception.hpp"
 
@@ -60,16 +62,64 @@ public:
     std::string err;
 };
 
+namespace {
+
+// The fallbacks for single and two channel textures expand each pixel the
+// same way the swizzle would, so shaders see the same channels either way.
+
+Image expand(const ImageR8& img)
+{
+    Image rval(img.width, img.height);
+    for (int y=0; y<img.height; ++y)
+    {
+        for (int x=0; x<img.width; ++x)
+        {
+            SubPixel r = img[y][x].r;
+            rval[y][x] = Pixel(r, r, r, r);
+        }
+    }
+    return rval;
+}
+
+Image expand(const ImageRG8& img)
+{
+    Image rval(img.width, img.height);
+    for (int y=0; y<img.height; ++y)
+    {
+        for (int x=0; x<img.width; ++x)
+        {
+            SubPixel r = img[y][x].r;
+            rval[y][x] = Pixel(r, r, r, img[y][x].g);
+        }
+    }
+    return rval;
+}
+
+} // namespace
+
 Texture::Shared::Shared()
     : id(0)
     , width()
     , height()
+    , smooth(false)
+    , clamp(false)
+    , resident(false)
+    , pinned(false)
+    , level(0)
+    , bytes(0)
+    , lastUsed(0.0)
+    , stash()
+    , loader()
+    , tiles()
+    , lru()
 {
     glGenTextures(1, &id);
+    TextureResidency::add(*this);
 }
 
 Texture::Shared::~Shared()
 {
+    TextureResidency::remove(*this);
     glDeleteTextures(1, &id);
 }
 
@@ -79,10 +129,103 @@ Texture::Texture(const Image& img, bool smooth, bool clamp)
     upload(img, smooth, clamp);
 }
 
+Texture::Texture(Loader loader, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    share->loader = std::move(loader);
+    upload(share->loader(), smooth, clamp);
+}
+
+Texture::Texture(const MappedImage& img, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    share->loader = [img]{ return img.getImage(); };
+    share->tiles = std::make_shared<MappedImage>(img);
+    share->width = img.getWidth();
+    share->height = img.getHeight();
+    share->smooth = smooth;
+    share->clamp = clamp;
+
+    TextureResidency::reserve(*share, tiledBytes(img, smooth));
+
+    storeTiles(*share, img);
+}
+
+Texture::Texture(const ImageR8& img, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    static const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_RED};
+
+    if (!GLEW_ARB_texture_rg || !GLEW_ARB_texture_swizzle)
+    {
+        upload(expand(img), smooth, clamp);
+        return;
+    }
+
+    share->width = img.width;
+    share->height = img.height;
+    share->smooth = smooth;
+    share->clamp = clamp;
+    share->pinned = true;
+
+    TextureResidency::reserve(*share, std::size_t(img.width)*img.height*sizeof(PixelR8));
+
+    storeFormat(*share, GL_R8, GL_RED, GL_UNSIGNED_BYTE, img[0], swizzle);
+}
+
+Texture::Texture(const ImageRG8& img, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    static const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_GREEN};
+
+    if (!GLEW_ARB_texture_rg || !GLEW_ARB_texture_swizzle)
+    {
+        upload(expand(img), smooth, clamp);
+        return;
+    }
+
+    share->width = img.width;
+    share->height = img.height;
+    share->smooth = smooth;
+    share->clamp = clamp;
+    share->pinned = true;
+
+    TextureResidency::reserve(*share, std::size_t(img.width)*img.height*sizeof(PixelRG8));
+
+    storeFormat(*share, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, img[0], swizzle);
+}
+
+Texture::Texture(const ImageRGBA16F& img, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    if (!GLEW_ARB_texture_float || !GLEW_ARB_half_float_pixel)
+    {
+        Image rval(img.width, img.height);
+        convert(img, rval);
+        upload(rval, smooth, clamp);
+        return;
+    }
+
+    share->width = img.width;
+    share->height = img.height;
+    share->smooth = smooth;
+    share->clamp = clamp;
+    share->pinned = true;
+
+    TextureResidency::reserve(*share, std::size_t(img.width)*img.height*sizeof(PixelRGBA16F));
+
+    storeFormat(*share, GL_RGBA16F_ARB, GL_RGBA, GL_HALF_FLOAT_ARB, img[0], nullptr);
+}
+
+Texture::Texture(const IndexedImage& img, bool smooth, bool clamp)
+    : Texture(img.toImage(), smooth, clamp)
+{}
+
 void Texture::bind(unsigned int slot) const
 {
     if (slot > 31) throw TextureException("Invalid texture slot!");
     glActiveTexture(GL_TEXTURE0+slot);
+    TextureResidency::touch(*share);
     glBindTexture(GL_TEXTURE_2D, share->id);
 }
 
@@ -96,18 +239,59 @@ int Texture::getHeight() const
     return share->height;
 }
 
+Image Texture::getImage() const
+{
+    if (share->level > 0 || !share->resident)
+    {
+        if (share->loader) return share->loader();
+        return share->stash;
+    }
+
+    Image rval(share->width, share->height);
+
+    GLint bound, packAlignment;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    glBindTexture(GL_TEXTURE_2D, share->id);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &rval[0][0]);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glBindTexture(GL_TEXTURE_2D, bound);
+
+    return rval;
+}
+
+bool Texture::isResident() const
+{
+    return (share && share->resident && share->level == 0);
+}
+
 void Texture::upload(const Image& img, bool smooth, bool clamp)
 {
     share->width = img.width;
     share->height = img.height;
+    share->smooth = smooth;
+    share->clamp = clamp;
+    share->level = 0;
+    share->stash = Image();
 
-    glBindTexture(GL_TEXTURE_2D, share->id);
+    TextureResidency::reserve(*share, std::size_t(img.width)*img.height*sizeof(Pixel));
+
+    store(*share, img);
+}
 
-    GLuint filter = (smooth)? GL_LINEAR : GL_NEAREST;
-    GLuint wrap   = (clamp )? GL_CLAMP  : GL_REPEAT;
+void Texture::store(Shared& s, const Image& img) //static
+{
+    glBindTexture(GL_TEXTURE_2D, s.id);
+
+    GLuint filter = (s.smooth)? GL_LINEAR : GL_NEAREST;
+    GLuint wrap   = (s.clamp )? GL_CLAMP  : GL_REPEAT;
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
@@ -123,6 +307,117 @@ void Texture::upload(const Image& img, bool smooth, bool clamp)
         , GL_UNSIGNED_BYTE
         , &img[0][0]
     );
+
+    s.resident = true;
+}
+
+void Texture::storeTiles(Shared& s, const MappedImage& img) //static
+{
+    glBindTexture(GL_TEXTURE_2D, s.id);
+
+    // Mip levels are only sampled with a smoothing filter.
+    const int levels = (s.smooth)? img.getLevels() : 1;
+
+    GLuint minFilter = (s.smooth)? ((levels > 1)? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR) : GL_NEAREST;
+    GLuint magFilter = (s.smooth)? GL_LINEAR : GL_NEAREST;
+    GLuint wrap      = (s.clamp )? GL_CLAMP  : GL_REPEAT;
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels-1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+    const int ts = img.getTileSize();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, ts);
+
+    for (int l=0; l<levels; ++l)
+    {
+        glTexImage2D(
+            GL_TEXTURE_2D
+            , l
+            , GL_RGBA
+            , img.getWidth(l)
+            , img.getHeight(l)
+            , 0
+            , GL_RGBA
+            , GL_UNSIGNED_BYTE
+            , nullptr
+        );
+
+        for (int ty=0; ty<img.getTilesY(l); ++ty)
+        {
+            for (int tx=0; tx<img.getTilesX(l); ++tx)
+            {
+                ConstImageView tile = img.getTile(l, tx, ty);
+                glTexSubImage2D(
+                    GL_TEXTURE_2D
+                    , l
+                    , tx*ts
+                    , ty*ts
+                    , tile.width
+                    , tile.height
+                    , GL_RGBA
+                    , GL_UNSIGNED_BYTE
+                    , tile[0]
+                );
+            }
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    s.resident = true;
+}
+
+std::size_t Texture::tiledBytes(const MappedImage& img, bool smooth) //static
+{
+    std::size_t rval = 0;
+    for (int i=0, e=(smooth? img.getLevels() : 1); i<e; ++i)
+    {
+        rval += std::size_t(img.getWidth(i))*img.getHeight(i)*sizeof(Pixel);
+    }
+    return rval;
+}
+
+void Texture::storeFormat(Shared& s, GLint internal, GLenum format, GLenum type, const void* data, const GLint* swizzle) //static
+{
+    glBindTexture(GL_TEXTURE_2D, s.id);
+
+    GLuint filter = (s.smooth)? GL_LINEAR : GL_NEAREST;
+    GLuint wrap   = (s.clamp )? GL_CLAMP  : GL_REPEAT;
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+    if (swizzle && GLEW_ARB_texture_swizzle)
+    {
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    // Rows of one and two byte pixels are not padded to four bytes.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glTexImage2D(
+        GL_TEXTURE_2D
+        , 0
+        , internal
+        , s.width
+        , s.height
+        , 0
+        , format
+        , type
+        , data
+    );
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    s.resident = true;
 }
 
 } // namespace Inugami
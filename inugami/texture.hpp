@@ -32,7 +32,11 @@
 
 #include "image.hpp"
 #include "opengl.hpp"
+#include "pixelformat.hpp"
 
+#include <cstddef>
+#include <functional>
+#include <list>
 #include <memory>
 #include <string>
 #include <utility>
@@ -45,7 +49,12 @@ namespace Inugami {
 class Texture
 {
     friend class TextureException;
+    friend class TextureResidency;
 public:
+    /*! @brief Function that reproduces a Texture's Image.
+     */
+    using Loader = std::function<Image()>;
+
     /*! @brief Default constructor.
      */
     Texture() = default;
@@ -60,7 +69,81 @@ public:
      */
     Texture(const Image& img, bool smooth=false, bool clamp=false);
 
+    /*! @brief Loader constructor.
+     *
+     *  Creates a Texture from the Image returned by the given Loader. If the
+     *  Texture is evicted by the TextureResidency manager, the Loader is
+     *  called again to reload it, instead of keeping a copy in memory.
+     *
+     *  @param loader Function that produces the Image to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(Loader loader, bool smooth=false, bool clamp=false);
+
+    /*! @brief Mapped image constructor.
+     *
+     *  Uploads the tiles of the given MappedImage straight from the mapping.
+     *  Smooth textures also upload the mip levels stored in the file. If the
+     *  Texture is evicted, it is reloaded from the mapping.
+     *
+     *  @param img MappedImage to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(const MappedImage& img, bool smooth=false, bool clamp=false);
+
+    /*! @brief Single channel constructor.
+     *
+     *  Stores the image with one byte per pixel. Where texture swizzling is
+     *  supported, the channel is read as red, green, blue, and alpha, so the
+     *  Texture works both as grayscale and as a mask read through @a .a.
+     *
+     *  Textures created from formats other than RGBA8 are never evicted by
+     *  the TextureResidency manager. Where the format is not supported, the
+     *  image is expanded to RGBA8 instead.
+     *
+     *  @param img Image to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(const ImageR8& img, bool smooth=false, bool clamp=false);
+
+    /*! @brief Two channel constructor.
+     *
+     *  Stores the image with two bytes per pixel. The channels are read as
+     *  gray and alpha.
+     *
+     *  @param img Image to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(const ImageRG8& img, bool smooth=false, bool clamp=false);
+
+    /*! @brief Floating point constructor.
+     *
+     *  Stores the image with a half-precision float per channel.
+     *
+     *  @param img Image to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(const ImageRGBA16F& img, bool smooth=false, bool clamp=false);
+
+    /*! @brief Indexed constructor.
+     *
+     *  Expands the palette and uploads the result as RGBA8.
+     *
+     *  @param img IndexedImage to upload.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to the image.
+     */
+    Texture(const IndexedImage& img, bool smooth=false, bool clamp=false);
+
     /*! @brief Binds the texture.
+     *
+     *  Marks the texture as used. If the texture was evicted, it is reloaded
+     *  before being bound.
      *
      *  @param slot Texture slot to bind.
      */
@@ -69,6 +152,22 @@ public:
     int getWidth() const;
     int getHeight() const;
 
+    /*! @brief Downloads the texture.
+     *
+     *  Reads the texture's pixels back from the GPU. Formats other than
+     *  RGBA8 are expanded without swizzling.
+     *
+     *  @return Image containing the texture's pixels.
+     */
+    Image getImage() const;
+
+    /*! @brief Returns @a true if the texture is fully resident.
+     *
+     *  A texture that was evicted, or is resident at a reduced resolution, is
+     *  not fully resident.
+     */
+    bool isResident() const;
+
 private:
     class Shared
     {
@@ -76,13 +175,28 @@ private:
         Shared();
         ~Shared();
         GLuint id;
-        int width;
-        int height;
+        int width;          //!< Width of the original Image.
+        int height;         //!< Height of the original Image.
+        bool smooth;
+        bool clamp;
+        bool resident;      //!< False if the GL storage was released.
+        bool pinned;        //!< True if the storage can not be evicted.
+        int level;          //!< Number of halvings of the resident storage.
+        std::size_t bytes;  //!< Size of the resident storage.
+        double lastUsed;
+        Image stash;        //!< CPU-side copy while not fully resident.
+        Loader loader;
+        std::shared_ptr<const MappedImage> tiles; //!< Restored with its mip levels.
+        std::list<Shared*>::iterator lru;
     };
 
     std::shared_ptr<Shared> share;
 
     void upload(const Image& data, bool smooth, bool clamp);
+    static void store(Shared& s, const Image& img);
+    static void storeTiles(Shared& s, const MappedImage& img);
+    static std::size_t tiledBytes(const MappedImage& img, bool smooth);
+    static void storeFormat(Shared& s, GLint internal, GLenum format, GLenum type, const void* data, const GLint* swizzle);
 };
 
 } // namespace Inugami
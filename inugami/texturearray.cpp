@@ -0,0 +1,186 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "texturearray.hpp"
+
+#include "exception.hpp"
+#include "geometry.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "spritesheet.hpp"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace Inugami {
+
+class TextureArrayException : public Exception
+{
+public:
+    TextureArrayException() = delete;
+
+    TextureArrayException(std::string error)
+    {
+        std::stringstream ss;
+        ss << "TextureArray Exception: ";
+        ss << std::move(error);
+        err = ss.str();
+    }
+
+    virtual const char* what() const noexcept override
+    {
+        return err.c_str();
+    }
+
+    std::string err;
+};
+
+TextureArray::Shared::Shared()
+    : id(0)
+    , width()
+    , height()
+    , layers()
+    , quad()
+{
+    glGenTextures(1, &id);
+}
+
+TextureArray::Shared::~Shared()
+{
+    glDeleteTextures(1, &id);
+}
+
+TextureArray::TextureArray(const std::vector<Image>& layers, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    upload(layers, smooth, clamp);
+}
+
+TextureArray::TextureArray(const Spritesheet& in, bool smooth, bool clamp)
+    : share (std::make_shared<Shared>())
+{
+    upload(in.getTiles(), smooth, clamp);
+}
+
+void TextureArray::bind(unsigned int slot) const
+{
+    if (slot > 31) throw TextureArrayException("Invalid texture slot!");
+    glActiveTexture(GL_TEXTURE0+slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, share->id);
+}
+
+void TextureArray::draw(const Shader& shader, int layer) const
+{
+    if (layer < 0 || layer >= share->layers) throw TextureArrayException("Invalid layer!");
+    shader.uniform("TexLayer").set(layer);
+    share->quad->draw();
+}
+
+const Mesh& TextureArray::getQuad() const
+{
+    return *share->quad;
+}
+
+int TextureArray::getWidth() const
+{
+    return share->width;
+}
+
+int TextureArray::getHeight() const
+{
+    return share->height;
+}
+
+int TextureArray::getLayers() const
+{
+    return share->layers;
+}
+
+void TextureArray::upload(const std::vector<Image>& layers, bool smooth, bool clamp)
+{
+    if (layers.empty()) throw TextureArrayException("No layers!");
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (int(layers.size()) > maxLayers) throw TextureArrayException("Too many layers!");
+
+    share->width  = layers[0].width;
+    share->height = layers[0].height;
+    share->layers = layers.size();
+
+    for (auto&& img : layers)
+    {
+        if (img.width != share->width || img.height != share->height)
+        {
+            throw TextureArrayException("Layers must have the same dimensions!");
+        }
+    }
+
+    share->quad.reset(new Mesh(Geometry::fromRect(share->width, share->height)));
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, share->id);
+
+    GLuint filter = (smooth)? GL_LINEAR        : GL_NEAREST;
+    GLuint wrap   = (clamp )? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY
+        , 0
+        , GL_RGBA8
+        , share->width
+        , share->height
+        , share->layers
+        , 0
+        , GL_RGBA
+        , GL_UNSIGNED_BYTE
+        , nullptr
+    );
+
+    for (int i=0; i<share->layers; ++i)
+    {
+        glTexSubImage3D(
+            GL_TEXTURE_2D_ARRAY
+            , 0
+            , 0, 0, i
+            , share->width
+            , share->height
+            , 1
+            , GL_RGBA
+            , GL_UNSIGNED_BYTE
+            , &layers[i][0][0]
+        );
+    }
+}
+
+} // namespace Inugami
@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_TEXTUREARRAY_H
+#define INUGAMI_TEXTUREARRAY_H
+
+#include "inugami.hpp"
+
+#include "image.hpp"
+#include "opengl.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Handle to a 2D texture array.
+ *
+ *  A TextureArray is a stack of equally sized layers that are bound together.
+ *  Sprites stored as layers can be drawn with a single unit quad and a layer
+ *  index, so sprites from many sheets can be drawn without rebinding
+ *  textures.
+ *
+ *  Layers are sampled with a @a sampler2DArray, such as the one used by
+ *  ShaderProgram::fromDefaultArray().
+ *
+ *  @note Not available with @a INU_NO_SHADERS.
+ */
+class TextureArray
+{
+public:
+    /*! @brief Default constructor.
+     */
+    TextureArray() = default;
+
+    /*! @brief Primary constructor.
+     *
+     *  Creates a TextureArray with one layer per Image. All Image%s must have
+     *  the same dimensions.
+     *
+     *  @param layers Images to upload, in layer order.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to each layer.
+     */
+    TextureArray(const std::vector<Image>& layers, bool smooth=false, bool clamp=true);
+
+    /*! @brief Spritesheet constructor.
+     *
+     *  Creates a TextureArray with one layer per tile of the given
+     *  Spritesheet. The tile at row @a r and column @a c is stored in layer
+     *  <tt>r*tilesX+c</tt>.
+     *
+     *  @param in Spritesheet to convert.
+     *  @param smooth Applies a smoothing filter.
+     *  @param clamp Clamps texture coordinates to each layer.
+     */
+    TextureArray(const Spritesheet& in, bool smooth=false, bool clamp=true);
+
+    /*! @brief Binds the texture array.
+     *
+     *  @param slot Texture slot to bind.
+     */
+    void bind(unsigned int slot) const;
+
+    /*! @brief Draws a layer on the quad.
+     *
+     *  Sets the @a TexLayer uniform of @a shader and draws getQuad(). The
+     *  shader and the array must already be bound, so a batch of sprites
+     *  from different layers is drawn without rebinding either.
+     *
+     *  @param shader Bound shader, such as one from
+     *  ShaderProgram::fromDefaultArray().
+     *  @param layer Layer to draw.
+     */
+    void draw(const Shader& shader, int layer) const;
+
+    /*! @brief Gets the quad that layers are drawn on.
+     *
+     *  The quad is the size of a layer in pixels, and is centered like the
+     *  tiles of a Spritesheet.
+     */
+    const Mesh& getQuad() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    int getLayers() const;
+
+private:
+    class Shared
+    {
+    public:
+        Shared();
+        ~Shared();
+        GLuint id;
+        int width;
+        int height;
+        int layers;
+        std::unique_ptr<Mesh> quad;
+    };
+
+    std::shared_ptr<Shared> share;
+
+    void upload(const std::vector<Image>& layers, bool smooth, bool clamp);
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_TEXTUREARRAY_H
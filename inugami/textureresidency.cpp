@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "textureresidency.hpp"
+
+#include "image.hpp"
+#include "opengl.hpp"
+
+#include <algorithm>
+#include <list>
+#include <utility>
+
+namespace Inugami {
+
+class TextureResidency::State
+{
+public:
+    State()
+        : budget(0)
+        , used(0)
+        , policy(TextureResidency::Policy::CPU)
+        , lru()
+    {}
+
+    std::size_t budget;
+    std::size_t used;
+    TextureResidency::Policy policy;
+    std::list<Shared*> lru; // Front is least recently used.
+};
+
+TextureResidency::State& TextureResidency::state() //static
+{
+    static State s;
+    return s;
+}
+
+namespace {
+
+int levelSize(int size, int level)
+{
+    return std::max(size>>level, 1);
+}
+
+Image halve(const Image& img)
+{
+    Image rval(levelSize(img.width, 1), levelSize(img.height, 1));
+
+    for (int r=0; r<rval.height; ++r)
+    {
+        const Pixel* row0 = img[std::min(r*2  , img.height-1)];
+        const Pixel* row1 = img[std::min(r*2+1, img.height-1)];
+        Pixel* out = rval[r];
+
+        for (int c=0; c<rval.width; ++c)
+        {
+            int c0 = std::min(c*2  , img.width-1);
+            int c1 = std::min(c*2+1, img.width-1);
+            for (int i=0; i<4; ++i)
+            {
+                out[c][i] = (row0[c0][i] + row0[c1][i] + row1[c0][i] + row1[c1][i] + 2) / 4;
+            }
+        }
+    }
+
+    return rval;
+}
+
+} // namespace
+
+void TextureResidency::setBudget(std::size_t bytes) //static
+{
+    state().budget = bytes;
+    trim();
+}
+
+std::size_t TextureResidency::getBudget() //static
+{
+    return state().budget;
+}
+
+std::size_t TextureResidency::getResidentBytes() //static
+{
+    return state().used;
+}
+
+void TextureResidency::setPolicy(Policy in) //static
+{
+    state().policy = in;
+}
+
+TextureResidency::Policy TextureResidency::getPolicy() //static
+{
+    return state().policy;
+}
+
+void TextureResidency::trim() //static
+{
+    makeRoom(0, nullptr);
+}
+
+void TextureResidency::evictUnused(double age) //static
+{
+    double limit = glfwGetTime() - age;
+
+    for (auto&& s : state().lru)
+    {
+        if (s->lastUsed >= limit) break;
+        if (s->resident && !s->pinned) evict(*s);
+    }
+}
+
+void TextureResidency::add(Shared& s) //static
+{
+    auto&& lru = state().lru;
+    s.lru = lru.insert(lru.end(), &s);
+}
+
+void TextureResidency::remove(Shared& s) //static
+{
+    account(s, 0);
+    state().lru.erase(s.lru);
+}
+
+void TextureResidency::touch(Shared& s) //static
+{
+    auto&& st = state();
+
+    s.lastUsed = glfwGetTime();
+    st.lru.splice(st.lru.end(), st.lru, s.lru);
+
+    if (!s.resident)
+    {
+        restore(s);
+    }
+    else if (s.level > 0)
+    {
+        std::size_t full = (s.tiles)? Texture::tiledBytes(*s.tiles, s.smooth)
+                                    : std::size_t(s.width)*s.height*sizeof(Pixel);
+        if (st.budget == 0 || st.used - s.bytes + full <= st.budget) restore(s);
+    }
+}
+
+void TextureResidency::reserve(Shared& s, std::size_t bytes) //static
+{
+    account(s, 0);
+    makeRoom(bytes, &s);
+    account(s, bytes);
+}
+
+void TextureResidency::account(Shared& s, std::size_t bytes) //static
+{
+    auto&& st = state();
+    st.used = st.used - s.bytes + bytes;
+    s.bytes = bytes;
+}
+
+void TextureResidency::makeRoom(std::size_t bytes, const Shared* keep) //static
+{
+    auto&& st = state();
+
+    if (st.budget == 0) return;
+
+    // Each pass evicts every candidate once, oldest first. Under Policy::MIP
+    // that halves many textures a step at a time instead of reducing the
+    // least recently used one to nothing.
+    bool progress = true;
+    while (progress && st.used + bytes > st.budget)
+    {
+        progress = false;
+        for (auto i = st.lru.begin(); i != st.lru.end() && st.used + bytes > st.budget; ++i)
+        {
+            if (*i == keep || !(*i)->resident || (*i)->pinned) continue;
+
+            evict(**i);
+            progress = true;
+        }
+    }
+}
+
+void TextureResidency::evict(Shared& s) //static
+{
+    int w = levelSize(s.width , s.level);
+    int h = levelSize(s.height, s.level);
+
+    // Eviction can happen while another texture is being stored.
+    GLint bound, packAlignment;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    // The full resolution image is stashed unless it can be reloaded.
+    Image current;
+    if (state().policy == Policy::MIP || (s.level == 0 && !s.loader))
+    {
+        current = Image(w, h);
+        glBindTexture(GL_TEXTURE_2D, s.id);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &current[0][0]);
+    }
+    if (s.level == 0 && !s.loader) s.stash = current;
+
+    if (state().policy == Policy::MIP && (w > 1 || h > 1))
+    {
+        Image lower = halve(current);
+        ++s.level;
+        account(s, std::size_t(lower.width)*lower.height*sizeof(Pixel));
+        Texture::store(s, lower);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, s.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        s.resident = false;
+        account(s, 0);
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glBindTexture(GL_TEXTURE_2D, bound);
+}
+
+void TextureResidency::restore(Shared& s) //static
+{
+    s.level = 0;
+
+    // Tiled textures keep their mip levels.
+    if (s.tiles)
+    {
+        reserve(s, Texture::tiledBytes(*s.tiles, s.smooth));
+        Texture::storeTiles(s, *s.tiles);
+        return;
+    }
+
+    Image img;
+    if (s.loader) img = s.loader();
+    else std::swap(img, s.stash);
+
+    reserve(s, std::size_t(img.width)*img.height*sizeof(Pixel));
+    Texture::store(s, img);
+}
+
+} // namespace Inugami
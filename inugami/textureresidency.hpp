@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_TEXTURERESIDENCY_H
+#define INUGAMI_TEXTURERESIDENCY_H
+
+#include "inugami.hpp"
+
+#include "texture.hpp"
+
+#include <cstddef>
+
+namespace Inugami {
+
+/*! @brief Texture memory manager.
+ *
+ *  Keeps track of how much texture memory is resident, and evicts the least
+ *  recently bound Texture%s when a byte budget is exceeded. Evicted
+ *  Texture%s are reloaded automatically the next time they are bound.
+ *
+ *  A budget of zero means that there is no limit, which is the default.
+ */
+class TextureResidency
+{
+    friend class Texture;
+public:
+    /*! @brief Eviction policy.
+     */
+    enum class Policy
+    {
+          CPU   //! Release the GL storage, keeping the pixels in memory.
+        , MIP   //! Halve the resident resolution, down to 1x1.
+    };
+
+    TextureResidency() = delete;
+
+    /*! @brief Sets the texture memory budget.
+     *
+     *  Textures are evicted immediately if the budget is exceeded.
+     *
+     *  @param bytes Budget in bytes, or 0 for no limit.
+     */
+    static void setBudget(std::size_t bytes);
+
+    /*! @brief Gets the texture memory budget.
+     */
+    static std::size_t getBudget();
+
+    /*! @brief Gets the number of bytes currently resident.
+     */
+    static std::size_t getResidentBytes();
+
+    /*! @brief Sets the eviction policy.
+     *
+     *  @param in Policy to use for future evictions.
+     */
+    static void setPolicy(Policy in);
+
+    /*! @brief Gets the eviction policy.
+     */
+    static Policy getPolicy();
+
+    /*! @brief Evicts textures until the budget is satisfied.
+     */
+    static void trim();
+
+    /*! @brief Evicts textures that haven't been bound recently.
+     *
+     *  @param age Time since last bind, in seconds.
+     */
+    static void evictUnused(double age);
+
+private:
+    using Shared = Texture::Shared;
+
+    class State;
+    static State& state();
+
+    static void add(Shared& s);
+    static void remove(Shared& s);
+    static void touch(Shared& s);
+    static void reserve(Shared& s, std::size_t bytes);
+    static void account(Shared& s, std::size_t bytes);
+    static void makeRoom(std::size_t bytes, const Shared* keep);
+    static void evict(Shared& s);
+    static void restore(Shared& s);
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_TEXTURERESIDENCY_H
@@ -0,0 +1,232 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace Inugami {
+
+namespace {
+
+// Number of loops the current thread is taking part in.
+thread_local int depth = 0;
+
+class Nesting
+{
+public:
+    Nesting()
+    {
+        ++depth;
+    }
+
+    ~Nesting()
+    {
+        --depth;
+    }
+};
+
+class Loop
+{
+public:
+    Loop(int b, int e, const std::function<void(int)>& f)
+        : next(b)
+        , end(e)
+        , func(f)
+        , mutex()
+        , idle()
+        , active(0)
+        , closed(false)
+        , error()
+    {}
+
+    // Runs indices until there are none left.
+    void run()
+    {
+        Nesting nesting;
+
+        for (int i = next++; i < end; i = next++)
+        {
+            try
+            {
+                func(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+                next = end;
+            }
+        }
+    }
+
+    // Called by workers. The loop may already be finished and returned,
+    // in which case func must not be touched.
+    void help()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed) return;
+            ++active;
+        }
+
+        run();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0) idle.notify_all();
+    }
+
+    // Called by the owner after its own run().
+    void finish()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        idle.wait(lock, [&]{ return active == 0; });
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    std::atomic<int> next;
+    const int end;
+    const std::function<void(int)>& func;
+
+    std::mutex mutex;
+    std::condition_variable idle;
+    int active;
+    bool closed;
+    std::exception_ptr error;
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int n)
+    : workers()
+    , tasks()
+    , mutex()
+    , wake()
+    , stopping(false)
+{
+    for (unsigned int i=0; i<n; ++i)
+    {
+        workers.emplace_back([this]{ work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (auto&& t : workers) t.join();
+}
+
+unsigned int ThreadPool::getConcurrency() const
+{
+    return workers.size()+1;
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int)>& func)
+{
+    if (end <= begin) return;
+
+    int helpers = std::min<int>(workers.size(), end-begin-1);
+
+    if (helpers <= 0 || depth > 0)
+    {
+        for (int i=begin; i<end; ++i) func(i);
+        return;
+    }
+
+    auto loop = std::make_shared<Loop>(begin, end, func);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i=0; i<helpers; ++i) tasks.emplace_back([loop]{ loop->help(); });
+    }
+
+    wake.notify_all();
+
+    loop->run();
+    loop->finish();
+}
+
+void ThreadPool::parallelBands(int rows, std::size_t rowBytes, const std::function<void(int,int)>& func, int minRows)
+{
+    int band = getBandRows(rows, rowBytes, minRows);
+    int count = (rows+band-1)/band;
+
+    parallelFor(0, count, [&](int i)
+    {
+        func(i*band, std::min((i+1)*band, rows));
+    });
+}
+
+int ThreadPool::getBandRows(int rows, std::size_t rowBytes, int minRows) const
+{
+    static constexpr std::size_t bandBytes = 256*1024;
+
+    int band = std::max<int>(bandBytes/std::max<std::size_t>(rowBytes, 1), 1);
+
+    // Keep enough bands around to balance the load.
+    int wanted = getConcurrency()*4;
+    if (rows/band < wanted) band = rows/wanted;
+
+    return std::max(band, std::max(minRows, 1));
+}
+
+ThreadPool& ThreadPool::global() //static
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u)-1);
+    return pool;
+}
+
+void ThreadPool::work()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]{ return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+} // namespace Inugami
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Inugami - An OpenGL framework designed for rapid game development
+ * Version: 0.3.0
+ * https://github.com/DBRalir/Inugami
+ *
+ * Copyright (c) 2012 Jeramy Harrison <dbralir@gmail.com>
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *  1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *  2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *  3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef INUGAMI_THREADPOOL_H
+#define INUGAMI_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Inugami {
+
+/*! @brief Fixed-size pool of worker threads.
+ *
+ *  Used to run data-parallel loops, such as Image kernels. The calling
+ *  thread always takes part in the work, so a pool with no workers simply
+ *  runs everything on the caller.
+ */
+class ThreadPool
+{
+public:
+    /*! @brief Primary constructor.
+     *
+     *  @param workers Number of worker threads to start.
+     */
+    explicit ThreadPool(unsigned int workers);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /*! @brief Destructor.
+     *
+     *  Waits for the workers to finish their current tasks.
+     */
+    ~ThreadPool();
+
+    /*! @brief Number of threads that take part in a loop.
+     *
+     *  This is the number of workers plus the calling thread.
+     */
+    unsigned int getConcurrency() const;
+
+    /*! @brief Runs a loop in parallel.
+     *
+     *  Calls @a func once for every index in <tt>[begin, end)</tt>, in no
+     *  particular order, and returns when all calls are finished. If a call
+     *  throws, the first exception is rethrown on the calling thread.
+     *
+     *  Loops started from inside another loop run on the calling thread, so
+     *  kernels can be used on small regions without flooding the queue.
+     *
+     *  @param begin First index.
+     *  @param end One past the last index.
+     *  @param func Function to call.
+     */
+    void parallelFor(int begin, int end, const std::function<void(int)>& func);
+
+    /*! @brief Runs a row kernel in cache-sized bands.
+     *
+     *  Splits @a rows into bands of roughly one L2 cache worth of data and
+     *  calls @a func with the half-open row range of each band.
+     *
+     *  @param rows Number of rows.
+     *  @param rowBytes Size of one row, in bytes.
+     *  @param func Function to call with the first and one past the last row.
+     *  @param minRows Minimum number of rows per band.
+     */
+    void parallelBands(int rows, std::size_t rowBytes, const std::function<void(int,int)>& func, int minRows=1);
+
+    /*! @brief Gets the band height used by parallelBands().
+     *
+     *  Useful for kernels that need to prepare per-band data, such as halo
+     *  rows, before running.
+     *
+     *  @param rows Number of rows.
+     *  @param rowBytes Size of one row, in bytes.
+     *  @param minRows Minimum number of rows per band.
+     *
+     *  @return Number of rows per band.
+     */
+    int getBandRows(int rows, std::size_t rowBytes, int minRows=1) const;
+
+    /*! @brief Gets the shared pool.
+     *
+     *  The shared pool has one worker less than the number of hardware
+     *  threads.
+     */
+    static ThreadPool& global();
+
+private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+};
+
+} // namespace Inugami
+
+#endif // INUGAMI_THREADPOOL_H
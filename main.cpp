@@ -55,6 +55,7 @@ int main(int argc, char* argv[])
 
     CustomCore::RenderParams renparams;
     renparams.fsaaSamples = 4;
+    renparams.shaderCache = "shadercache";
 
     {
         std::unordered_map<std::string, std::function<void()>> argf = {
@@ -62,6 +63,7 @@ int main(int argc, char* argv[])
             , {"--windowed",   [&]{renparams.fullscreen=false;}}
             , {"--vsync",      [&]{renparams.vsync=true;}}
             , {"--no-vsync",   [&]{renparams.vsync=false;}}
+            , {"--render-thread", [&]{renparams.renderThread=true;}}
         };
 
         while (*++argv)
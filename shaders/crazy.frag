@@ -10,7 +10,6 @@ uniform float hue;
 uniform float dissolveMin;
 uniform float dissolveMax;
 uniform vec3 lightPos;
-uniform bool useDissolve;
 
 out vec4 FragColor;
 
@@ -60,7 +59,10 @@ vec4 applyDissolve(vec4 c)
 
 void main() {
     vec4 texcolor = texture(Tex0, TexCoord);
-    if (useDissolve) texcolor = applyDissolve(texcolor);
-    else texcolor = applyLight(applyShift(texcolor, 1.0));
+#ifdef DISSOLVE
+    texcolor = applyDissolve(texcolor);
+#else
+    texcolor = applyLight(applyShift(texcolor, 1.0));
+#endif
     FragColor = texcolor;
 }
@@ -4,9 +4,16 @@ layout (location = 0) in vec3 VertexPosition;
 layout (location = 1) in vec3 VertexNormal;
 layout (location = 2) in vec2 VertexTexCoord;
 
-uniform mat4 viewMatrix;
+layout (std140) uniform Frame
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjection;
+    vec2 screenSize;
+    float time;
+};
+
 uniform mat4 modelMatrix;
-uniform mat4 MVP;
 
 out vec3 Position;
 out vec3 Normal;
@@ -18,6 +25,6 @@ void main()
     Normal = (viewMatrix * modelMatrix*vec4(VertexNormal,0.0)).xyz;
     Normal = normalize(Normal);
     Position = (viewMatrix * modelMatrix*vec4(VertexPosition,1.0)).xyz;
-    vec4 result = MVP * vec4(VertexPosition,1.0);
+    vec4 result = viewProjection * modelMatrix * vec4(VertexPosition,1.0);
     gl_Position = result;
 }